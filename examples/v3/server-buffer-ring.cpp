@@ -0,0 +1,45 @@
+#include "magio-v3/magio.h"
+
+using namespace std;
+using namespace magio;
+using namespace chrono_literals;
+
+Coro<> handle_conn(net::Socket sock) {
+    for (; ;) {
+        auto buf = co_await sock.receive_buffer() | throw_on_err;
+        if (buf.size() == 0) {
+            M_INFO("{}", "EOF");
+            break;
+        }
+        M_INFO("receive: {}", string_view(buf.data(), buf.size()));
+        co_await sock.send(buf.data(), buf.size()) | throw_on_err;
+    }
+}
+
+Coro<> server() {
+    auto local = net::InetAddress::from("::1", 1234) | panic_on_err;
+    auto acceptor = net::Acceptor::listen(local) | panic_on_err;
+
+    for (; ;) {
+        error_code ec;
+        auto [socket, peer] = co_await acceptor.accept() | redirect_err(ec);
+        if (ec) {
+            M_ERROR("{}", ec.message());
+        } else {
+            M_INFO("accept [{}]:{}", peer.ip(), peer.port());
+            this_context::spawn(handle_conn(std::move(socket)), [](exception_ptr eptr, Unit) {
+                try {
+                    try_rethrow(eptr);
+                } catch(const std::system_error& err) {
+                    M_ERROR("{}", err.what());
+                }
+            });
+        }
+    }
+}
+
+int main() {
+    CoroContext ctx(128);
+    this_context::spawn(server());
+    ctx.start();
+}
@@ -10,37 +10,56 @@ public:
     { }
 
     void start() {
-        this_context::spawn(server());
+        auto local = net::InetAddress::from("::1", 1234) | panic_on_err;
+        error_code ec;
+        // every context accepts on its own listener, no hop to another thread
+        auto acceptors = pool_.listen(local) | redirect_err(ec);
+        if (ec == errc::not_supported) {
+            // no SO_REUSEPORT (windows), one listener hands the connections out
+            auto acceptor = net::Acceptor::listen(local) | panic_on_err;
+            pool_.get(0).spawn(single_server(std::move(acceptor)));
+            return;
+        } else if (ec) {
+            M_FATAL("listen error: {}", ec.message());
+        }
+
+        for (size_t i = 0; i < acceptors.size(); ++i) {
+            pool_.get(i).spawn(server(std::move(acceptors[i])));
+        }
     }
 
 private:
-    Coro<> server() {
-        error_code ec;
-        auto local = net::InetAddress::from("::1", 1234) | panic_on_err;
-        acceptor_ = net::Acceptor::listen(local) | panic_on_err;
+    static void on_conn_done(exception_ptr eptr, Unit) {
+        try {
+            try_rethrow(eptr);
+        } catch(const system_error& err) {
+            M_ERROR("{}", err.what());
+        }
+    }
 
-        for (size_t i = 0; i < 10; ++i) {
-            this_context::spawn(accept());
+    Coro<> single_server(net::Acceptor acceptor) {
+        for (; ;) {
+            error_code ec;
+            auto [socket, peer] = co_await acceptor.accept() | redirect_err(ec);
+            if (ec) {
+                M_ERROR("accept error: {}", ec.message());
+            } else {
+                M_INFO("accept [{}]:{}", peer.ip(), peer.port());
+                pool_.next_context().spawn(handle_conn(std::move(socket)), on_conn_done);
+            }
         }
-        
-        co_return;
     }
 
-    Coro<> accept() {
+    Coro<> server(net::Acceptor acceptor) {
+        // one multishot accept keeps yielding connections
         for (; ;) {
             error_code ec;
-            auto [socket, peer] = co_await acceptor_.accept() | redirect_err(ec);
+            auto [socket, peer] = co_await acceptor.accept_multishot() | redirect_err(ec);
             if (ec) {
                 M_ERROR("accept error: {}", ec.message());
             } else {
                 M_INFO("accept [{}]:{}", peer.ip(), peer.port());
-                pool_.next_context().spawn(handle_conn(std::move(socket)), [](exception_ptr eptr, Unit) {
-                    try {
-                        try_rethrow(eptr);
-                    } catch(const system_error& err) {
-                        M_ERROR("{}", err.what());
-                    }
-                });
+                this_context::spawn(handle_conn(std::move(socket)), on_conn_done);
             }
         }
     }
@@ -59,7 +78,6 @@ private:
     }
 
     CoroContextPool& pool_;
-    net::Acceptor acceptor_;
 };
 
 int main() {
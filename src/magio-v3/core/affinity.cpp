@@ -0,0 +1,131 @@
+#include "magio-v3/core/affinity.h"
+
+#include <set>
+#include <string>
+#include <fstream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined (__linux__)
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+#include "magio-v3/core/error.h"
+
+namespace magio {
+
+std::vector<std::vector<int>> CpuAffinity::resolve(size_t num) const {
+    std::vector<std::vector<int>> result(num);
+    if (physical_cores) {
+        auto cores = magio::physical_cores();
+        for (size_t i = 0; i < num && !cores.empty(); ++i) {
+            result[i] = {cores[i % cores.size()]};
+        }
+        return result;
+    }
+
+    for (size_t i = 0; i < num && i < cpus.size(); ++i) {
+        result[i] = cpus[i];
+    }
+    return result;
+}
+
+#ifdef __linux__
+// -1 if unknown
+static int read_topology(int cpu, const char* name) {
+    std::ifstream in("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+    int value = -1;
+    in >> value;
+    return in ? value : -1;
+}
+#endif
+
+std::vector<int> physical_cores() {
+    std::vector<int> cores;
+#ifdef _WIN32
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+    if (!::GetProcessAffinityMask(::GetCurrentProcess(), &process_mask, &system_mask)) {
+        return cores;
+    }
+
+    DWORD len = 0;
+    ::GetLogicalProcessorInformationEx(RelationProcessorCore, nullptr, &len);
+    std::vector<char> buf(len);
+    if (!::GetLogicalProcessorInformationEx(
+        RelationProcessorCore, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buf.data(), &len)) 
+    {
+        return cores;
+    }
+
+    // one record per physical core, its smt siblings share the mask.
+    // only the first group, bind_this_thread pins within it
+    for (DWORD offset = 0; offset < len; ) {
+        auto info = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)(buf.data() + offset);
+        offset += info->Size;
+        for (WORD i = 0; i < info->Processor.GroupCount; ++i) {
+            const GROUP_AFFINITY& group = info->Processor.GroupMask[i];
+            KAFFINITY mask = group.Mask & process_mask;
+            if (group.Group != 0 || mask == 0) {
+                continue;
+            }
+
+            int cpu = 0;
+            while (!(mask & ((KAFFINITY)1 << cpu))) {
+                ++cpu;
+            }
+            cores.push_back(cpu);
+        }
+    }
+#elif defined (__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (-1 == ::sched_getaffinity(0, sizeof(set), &set)) {
+        return cores;
+    }
+
+    // (package, core) of the cores already taken
+    std::set<std::pair<int, int>> seen;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &set)) {
+            continue;
+        }
+
+        int package = read_topology(cpu, "physical_package_id");
+        int core = read_topology(cpu, "core_id");
+        // without topology every cpu counts as a core
+        if (core == -1 || seen.emplace(package, core).second) {
+            cores.push_back(cpu);
+        }
+    }
+#endif
+    return cores;
+}
+
+void bind_this_thread(const std::vector<int>& cpus, std::error_code& ec) {
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < (int)sizeof(DWORD_PTR) * 8) {
+            mask |= (DWORD_PTR)1 << cpu;
+        }
+    }
+    if (0 == ::SetThreadAffinityMask(::GetCurrentThread(), mask)) {
+        ec = SYSTEM_ERROR_CODE;
+    }
+#elif defined (__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (int err = ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set); err != 0) {
+        ec = make_system_error_code(err);
+    }
+#endif
+}
+
+}
@@ -0,0 +1,33 @@
+#ifndef MAGIO_CORE_AFFINITY_H_
+#define MAGIO_CORE_AFFINITY_H_
+
+#include <vector>
+#include <system_error>
+
+namespace magio {
+
+// which cpus the threads of a pool run on
+struct CpuAffinity {
+    // the i-th set pins the i-th thread, threads past the end are not pinned
+    std::vector<std::vector<int>> cpus;
+    // the i-th thread gets the i-th physical core the process may run on,
+    // smt siblings are skipped, wraps around if there are more threads. 
+    // replaces cpus
+    bool physical_cores = false;
+
+    // the cpus of each of num threads, empty -> not pinned
+    std::vector<std::vector<int>> resolve(size_t num) const;
+};
+
+// the first logical cpu of every physical core the process may run on,
+// on windows those of the first processor group
+std::vector<int> physical_cores();
+
+// pins the calling thread. the kernel places memory on the node of the cpu 
+// that touches it first, so whatever the thread allocates afterwards
+// (its ring, buffer ring, frame and free list caches) is node local
+void bind_this_thread(const std::vector<int>& cpus, std::error_code& ec);
+
+}
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef MAGIO_CORE_COMMON_H_
 #define MAGIO_CORE_COMMON_H_
 
+#include <cstddef>
+
 namespace magio {
 
 using SocketHandle = 
@@ -19,6 +21,12 @@ struct IoHandle {
 
 constexpr SocketHandle kInvalidHandle = (SocketHandle)-1;
 
+// one buffer of a scatter/gather op, the layout of iovec on linux
+struct IoVec {
+    char* buf;
+    size_t len;
+};
+
 }
 
 #endif
\ No newline at end of file
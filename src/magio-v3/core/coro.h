@@ -5,6 +5,7 @@
 #include <exception>
 
 #include "magio-v3/utils/noncopyable.h"
+#include "magio-v3/utils/frame_pool.h"
 #include "magio-v3/core/this_context.h"
 
 namespace magio {
@@ -14,6 +15,28 @@ namespace detail {
 
 inline thread_local size_t CoroNum = 0;
 
+// cooperative scheduling: the ops a coroutine may finish without suspending
+// before it has to yield, refilled whenever the context resumes something.
+// set by the context from CoroContextOptions::coop_budget, 0 -> unlimited
+inline thread_local unsigned CoopLimit = 0;
+inline thread_local unsigned CoopBudget = 0;
+
+inline void reset_coop_budget() {
+    CoopBudget = CoopLimit;
+}
+
+// false: the budget is spent, the caller should yield instead of going on
+inline bool consume_coop_budget() {
+    if (CoopLimit == 0) {
+        return true;
+    }
+    if (CoopBudget == 0) {
+        return false;
+    }
+    --CoopBudget;
+    return true;
+}
+
 class Yield {
 public:
     bool await_ready() { 
@@ -32,23 +55,39 @@ public:
 template<typename = void>
 class Coro;
 
+// co_await Coro, the awaiting coroutine jumps straight into the child 
+// and the child jumps back when it finishes. the child's frame is owned
+// by the awaitable, it is kept until the result is taken, then destroyed here
 template<typename T>
-class Awaitable {
+class Awaitable: Noncopyable {
 public:
     using CoroutineHandle = typename Coro<T>::CoroutineHandle;
 
     Awaitable(CoroutineHandle h)
         : handle_(h) { }
 
+    ~Awaitable() {
+        if (handle_ && (handle_.done() || !handle_.promise().is_launched)) {
+            --detail::CoroNum;
+            handle_.destroy();
+        }
+    }
+
     bool await_ready() { 
         return false; 
     }
 
     template<typename PT>
-    void await_suspend(std::coroutine_handle<PT> prev_h) {
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<PT> prev_h) {
         handle_.promise().is_launched = true;
         handle_.promise().prev_handle = prev_h;
-        this_context::queue_in_context(handle_); // wake main then prev
+        if (detail::consume_coop_budget()) {
+            return handle_;
+        }
+
+        // out of budget, the child starts on the run queue
+        this_context::queue_in_context(handle_);
+        return std::noop_coroutine();
     }
 
     T await_resume() noexcept {
@@ -98,10 +137,14 @@ public:
         return false; 
     }
 
-    void await_suspend(CoroutineHandle self_h) const noexcept {
+    // awaited: back to the awaiting coroutine, which destroys this frame
+    // spawned: hands the result to the callback and destroys this frame
+    std::coroutine_handle<> await_suspend(CoroutineHandle self_h) const noexcept {
         if (self_h.promise().prev_handle) {
-            self_h.promise().prev_handle.resume();
-        } else if (self_h.promise().callback) {
+            return self_h.promise().prev_handle;
+        }
+        
+        if (self_h.promise().callback) {
             auto peptr = std::get_if<std::exception_ptr>(&self_h.promise().storage);
             if constexpr (std::is_void_v<T>) {
                 if (peptr) {
@@ -123,6 +166,7 @@ public:
 
         --detail::CoroNum;
         self_h.destroy();
+        return std::noop_coroutine();
     }
 
     constexpr void await_resume() const noexcept { }
@@ -163,6 +207,14 @@ public:
             return {CoroutineHandle::from_promise(*this)};
         }
 
+        static void* operator new(size_t size) {
+            return FramePool::allocate(size);
+        }
+
+        static void operator delete(void* p) {
+            FramePool::deallocate(p);
+        }
+
         std::suspend_always initial_suspend() {
             return {};
         };
@@ -202,8 +254,9 @@ public:
         handle_.promise().callback = std::move(handler);
     }
 
-    auto operator co_await() const {
-        return Awaitable<Return>{handle_};
+    // the awaitable takes the frame over, it is gone once the result is taken
+    auto operator co_await() && {
+        return Awaitable<Return>{std::exchange(handle_, {})};
     }
 private:
     
@@ -245,6 +298,14 @@ public:
             return {CoroutineHandle::from_promise(*this)};
         }
 
+        static void* operator new(size_t size) {
+            return FramePool::allocate(size);
+        }
+
+        static void operator delete(void* p) {
+            FramePool::deallocate(p);
+        }
+
         std::suspend_always initial_suspend() { 
             return {};
         };
@@ -277,8 +338,9 @@ public:
         handle_.promise().callback = std::move(handler);
     }
 
-    auto operator co_await() const {
-        return Awaitable<void>{handle_};
+    // the awaitable takes the frame over, it is gone once the result is taken
+    auto operator co_await() && {
+        return Awaitable<void>{std::exchange(handle_, {})};
     }
 
 private:
@@ -1,6 +1,7 @@
 #include "magio-v3/core/coro_context.h"
 
 #include "magio-v3/utils/logger.h"
+#include "magio-v3/core/io_context.h"
 #ifdef _WIN32
 #include "magio-v3/net/iocp.h"
 #define IOSERVICE(X) std::make_unique<::magio::net::IoCompletionPort>()
@@ -12,18 +13,36 @@
 namespace magio {
 
 CoroContext::CoroContext(size_t entries)
+    : CoroContext(CoroContextOptions{.entries = (unsigned)entries})
+{ }
+
+CoroContext::CoroContext(const CoroContextOptions& options)
     : thread_id_(CurrentThread::get_id()) 
+    , task_budget_(options.task_budget)
+#ifdef MAGIO_USE_CORO
+    , lifo_cap_(options.lifo_cap)
+#endif
+    , max_spin_ns_(options.busy_poll_us * 1000ULL)
+    , spin_ns_(max_spin_ns_)
 {
     if (LocalContext != nullptr) {
         M_FATAL("{}", "This thread already has a context");
     }
 
-    if (entries == 0) {
+    if (options.entries == 0) {
         M_FATAL("{}", "Entries cannot be zero");
     }
 
-    io_service_ = IOSERVICE(entries);
+    io_service_ = IOSERVICE(options);
     LocalContext = this;
+#ifdef MAGIO_USE_CORO
+    detail::CoopLimit = options.coop_budget;
+    detail::reset_coop_budget();
+    // a coroutine an io completion woke up on this context runs before the next one
+    io_service_->set_completion_hook([](void* ptr) {
+        static_cast<CoroContext*>(ptr)->run_lifo_slot();
+    }, this);
+#endif
 }
 
 void CoroContext::start() {
@@ -36,37 +55,108 @@ void CoroContext::start() {
     }
 
     state_ = Running;
-    decltype(pending_handles_) handles;
+    decltype(local_tasks_) handles;
+    // handles before it have run, the rest is left over from the budget
+    size_t cursor = 0;
     std::vector<TimerTask> timer_tasks;
 
     for (; state_ != Stopping;) {
-        {
-            std::lock_guard lk(mutex_);
-            handles.swap(pending_handles_);
+        if (handles.empty()) {
+            handles.swap(local_tasks_);
+        } else {
+            for (auto& task : local_tasks_) {
+                handles.push_back(std::move(task));
+            }
+            local_tasks_.clear();
         }
-        for (auto& func : handles) {
-            func();
+        remote_tasks_.pop_all(handles);
+        if (!peers_.empty()) {
+            // no more than the budget takes, the rest stays stealable
+            size_t pending = handles.size() - cursor;
+            size_t room = task_budget_ ? task_budget_ - std::min(task_budget_, pending) : SIZE_MAX;
+            std::lock_guard lk(steal_mutex_);
+            for (; room > 0 && !stealable_.empty(); --room) {
+                handles.push_back(std::move(stealable_.front()));
+                stealable_.pop_front();
+            }
+        }
+
+        // a live coroutine is either queued or waits on its io, both counted here
+        size_t load = handles.size() - cursor + io_service_->inflight();
+#ifdef MAGIO_USE_CORO
+        run_continuations();
+        run_lifo_slot();
+#endif
+        load_.store(load, std::memory_order_relaxed);
+
+        size_t end = task_budget_ ? std::min(handles.size(), cursor + task_budget_) : handles.size();
+        for (; cursor < end; ++cursor) {
+#ifdef MAGIO_USE_CORO
+            detail::reset_coop_budget();
+            handles[cursor]();
+            run_lifo_slot();
+#else
+            handles[cursor]();
+#endif
+        }
+        if (cursor == handles.size()) {
+            // TODO shrink
+            handles.clear();
+            cursor = 0;
+        } else if (cursor >= handles.size() / 2) {
+            // the run prefix goes once it is at least half, so each task moves O(1) times
+            handles.erase(handles.begin(), handles.begin() + cursor);
+            cursor = 0;
         }
-        // TODO shrink
-        handles.clear();
 
         timer_queue_.get_expired(timer_tasks);
         for (auto& task : timer_tasks) {
+#ifdef MAGIO_USE_CORO
+            detail::reset_coop_budget();
+            task(true);
+            run_lifo_slot();
+#else
             task(true);
+#endif
         }
         // TODO shrink
         timer_tasks.clear();
 
         std::error_code ec;
         auto next_duration = timer_queue_.next_duration();
+        if (max_spin_ns_ && next_duration.count() > 0 && state_ != Stopping && handles.empty()
+            && local_tasks_.empty() && remote_tasks_.empty() && busy_poll(next_duration)) 
         {
-            std::lock_guard lk(mutex_);
-            if (!pending_handles_.empty() || state_ == Stopping) {
-                next_duration = TimerClock::duration(0);
+            continue;
+        }
+
+        // set before the queue is checked, a post after the check sees it
+        sleeping_.store(true);
+        bool has_work = !handles.empty() || !local_tasks_.empty() || !remote_tasks_.empty() 
+            || state_ == Stopping;
+#ifdef MAGIO_USE_CORO
+        has_work = has_work || lifo_slot_ || !continuations_.empty() || !remote_continuations_.empty();
+#endif
+        if (!has_work && !peers_.empty()) {
+            {
+                std::lock_guard lk(steal_mutex_);
+                has_work = !stealable_.empty();
             }
+            has_work = has_work || steal();
+        }
+        if (has_work) {
+            next_duration = TimerClock::duration(0);
+        }
+        if (next_duration.count() == 0) {
+            sleeping_.store(false);
         }
         
+#ifdef MAGIO_USE_CORO
+        // the coroutines resumed by one batch of completions share it
+        detail::reset_coop_budget();
+#endif
         int status = io_service_->poll(next_duration.count(), ec);
+        sleeping_.store(false);
         if (-1 == status) {
             M_SYS_ERROR("Io service error: {}, then the context will be stopped", ec.message());
             stop();
@@ -83,13 +173,17 @@ void CoroContext::stop() {
 }
 
 void CoroContext::execute(Task &&task) {
-    {
-        std::lock_guard lk(mutex_);
-        pending_handles_.push_back(std::move(task));
+    if (LocalContext == this) {
+        local_tasks_.push_back(std::move(task));
+        return;
     }
 
-    if (!assert_in_context_thread()) {
-        wake_up();
+    // the message leaves with the sender's next submission, so its loop must be running
+    if (LocalContext && LocalContext->state_ == Running && !LocalContext->no_message_) 
+    {
+        send_task(std::move(task));
+    } else {
+        push_task(std::move(task));
     }
 }
 
@@ -113,16 +207,198 @@ void CoroContext::wake_in_context(std::coroutine_handle<> h) {
 void CoroContext::queue_in_context(std::coroutine_handle<> h) {
     execute([h]() mutable { h.resume(); });
 }
+
+void CoroContext::resume_in_context(std::coroutine_handle<> h) {
+    if (LocalContext == this) {
+        if (lifo_cap_ == 0) {
+            continuations_.push_back(h);
+            return;
+        }
+
+        // the most recent one runs next, the one it displaces keeps its turn
+        // at the front of the continuations
+        if (lifo_slot_) {
+            continuations_.insert(continuations_.begin(), lifo_slot_);
+        }
+        lifo_slot_ = h;
+        return;
+    }
+
+    remote_continuations_.push(std::move(h));
+    if (sleeping_.exchange(false)) {
+        wake_up();
+    }
+}
+
+void CoroContext::run_continuations() {
+    // the ones queued while running wait for the next tick
+    running_continuations_.swap(continuations_);
+    remote_continuations_.pop_all(running_continuations_);
+    for (auto h : running_continuations_) {
+        detail::reset_coop_budget();
+        h.resume();
+        run_lifo_slot();
+    }
+    running_continuations_.clear();
+}
+
+void CoroContext::run_lifo_slot() {
+    // two coroutines playing ping pong take turns here, 
+    // the cap gives the queued tasks their turn
+    for (unsigned n = 0; lifo_slot_; ++n) {
+        auto h = std::exchange(lifo_slot_, nullptr);
+        if (n == lifo_cap_) {
+            continuations_.push_back(h);
+            return;
+        }
+
+        detail::reset_coop_budget();
+        h.resume();
+    }
+}
+
+void CoroContext::spawn_handle(std::coroutine_handle<> h) {
+    if (peers_.empty()) {
+        queue_in_context(h);
+    } else {
+        push_stealable([h]() mutable { h.resume(); });
+    }
+}
 #endif
 
 void CoroContext::wake_up() {
     io_service_->wake_up();
 }
 
+bool CoroContext::busy_poll(TimerClock::duration limit) {
+    auto begin = TimerClock::now();
+    auto until = begin + std::min<TimerClock::duration>(std::chrono::nanoseconds(spin_ns_.load(std::memory_order_relaxed)), limit);
+    auto now = begin;
+    bool hit = false;
+    std::error_code ec;
+    do {
+#ifdef MAGIO_USE_CORO
+        detail::reset_coop_budget();
+#endif
+        int status = io_service_->poll(0, ec);
+        if (-1 == status) {
+            M_SYS_ERROR("Io service error: {}, then the context will be stopped", ec.message());
+            stop();
+            return true;
+        }
+        hit = 1 == status || !local_tasks_.empty() || !remote_tasks_.empty();
+#ifdef MAGIO_USE_CORO
+        hit = hit || lifo_slot_ || !continuations_.empty() || !remote_continuations_.empty();
+#endif
+        now = TimerClock::now();
+    } while (!hit && now < until);
+
+    // follows the completion rate: busy -> spin longer, idle -> give the cpu back sooner
+    uint64_t spin_ns = spin_ns_.load(std::memory_order_relaxed);
+    if (hit) {
+        spin_ns = std::min(spin_ns * 2, max_spin_ns_);
+    } else {
+        spin_ns = std::max<uint64_t>(spin_ns / 2, std::max<uint64_t>(max_spin_ns_ / 32, 1));
+    }
+    spin_ns_.store(spin_ns, std::memory_order_relaxed);
+
+    auto spent = std::chrono::duration_cast<std::chrono::nanoseconds>(now - begin).count();
+    spin_total_ns_.store(spin_total_ns_.load(std::memory_order_relaxed) + spent, std::memory_order_relaxed);
+    spins_.store(spins_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (hit) {
+        spin_hits_.store(spin_hits_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    return hit;
+}
+
+void CoroContext::push_task(Task &&task) {
+    remote_tasks_.push(std::move(task));
+
+    // only the first post after the loop went to sleep wakes it up
+    if (sleeping_.exchange(false)) {
+        wake_up();
+    }
+}
+
+void CoroContext::push_stealable(Task &&task) {
+    size_t backlog;
+    {
+        std::lock_guard lk(steal_mutex_);
+        stealable_.push_back(std::move(task));
+        backlog = stealable_.size();
+    }
+
+    if (sleeping_.load() && sleeping_.exchange(false)) {
+        wake_up();
+        return;
+    }
+
+    // busy, more than its next tick picks up, so one idle peer comes to steal
+    if (backlog > 1) {
+        for (auto peer : peers_) {
+            if (peer->sleeping_.load() && peer->sleeping_.exchange(false)) {
+                peer->wake_up();
+                break;
+            }
+        }
+    }
+}
+
+bool CoroContext::steal() {
+    for (size_t i = 0; i < peers_.size(); ++i) {
+        auto peer = peers_[(steal_idx_ + i) % peers_.size()];
+        std::unique_lock lk(peer->steal_mutex_, std::try_to_lock);
+        if (!lk || peer->stealable_.empty()) {
+            continue;
+        }
+
+        // the oldest ones, the victim keeps the newer half
+        for (size_t n = (peer->stealable_.size() + 1) / 2; n > 0; --n) {
+            local_tasks_.push_back(std::move(peer->stealable_.front()));
+            peer->stealable_.pop_front();
+        }
+        // the next attempt starts from the following peer
+        steal_idx_ = (steal_idx_ + i + 1) % peers_.size();
+        return true;
+    }
+
+    return false;
+}
+
+void CoroContext::send_task(Task &&task) {
+    struct Message {
+        Task task;
+        CoroContext* target;
+    };
+
+    LocalContext->get_service().send_message(get_service(), new Message{std::move(task), this}, 
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto msg = (Message*)ptr;
+            delete ioc;
+            if (ec) {
+                // back on the sender, which stops trying
+                LocalContext->no_message_ = true;
+                msg->target->push_task(std::move(msg->task));
+            } else {
+                msg->task();
+            }
+            delete msg;
+        });
+}
+
 IoService CoroContext::get_service() const {
     return {io_service_.get()};
 }
 
+CoroContextStats CoroContext::stats() const {
+    return {
+        .spin_ns = spin_total_ns_.load(std::memory_order_relaxed),
+        .spins = spins_.load(std::memory_order_relaxed),
+        .spin_hits = spin_hits_.load(std::memory_order_relaxed),
+        .spin_budget_ns = spin_ns_.load(std::memory_order_relaxed),
+    };
+}
+
 bool CoroContext::assert_in_context_thread() {
     return thread_id_ == CurrentThread::get_id();
 }
@@ -2,13 +2,31 @@
 #define MAGIO_CORE_CO_CONTEXT_H_
 
 #include <mutex>
+#include <deque>
+#include <atomic>
 
 #include "magio-v3/core/coro.h"
+#include "magio-v3/core/options.h"
 #include "magio-v3/core/timer_queue.h"
+#include "magio-v3/utils/mpsc_queue.h"
 
 namespace magio {
 
+class CoroContextPool;
+
+struct CoroContextStats {
+    // time spent busy polling
+    uint64_t spin_ns = 0;
+    // busy poll phases, those that found work before running out
+    uint64_t spins = 0;
+    uint64_t spin_hits = 0;
+    // the current adaptive length of a busy poll
+    uint64_t spin_budget_ns = 0;
+};
+
 class CoroContext: Noncopyable, public Executor {
+    friend class CoroContextPool;
+
 public:
     enum State {
         Running, Stopping, 
@@ -16,6 +34,8 @@ public:
 
     CoroContext(size_t entries);
 
+    CoroContext(const CoroContextOptions& options);
+
     void start();
 
     void stop();
@@ -28,20 +48,25 @@ public:
     template<typename T>
     void spawn(Coro<T> coro) {
         coro.launch();
-        queue_in_context(coro.handle());
+        spawn_handle(coro.handle());
     }
 
     template<typename T>
     void spawn(Coro<T> coro, CoroCompletionHandler<T>&& handler) {
         coro.launch();
         coro.set_callback(std::move(handler));
-        queue_in_context(coro.handle());
+        spawn_handle(coro.handle());
     }
 
     void wake_in_context(std::coroutine_handle<>);
 
     void queue_in_context(std::coroutine_handle<>);
 
+    // a coroutine whose operation completed (lock hand off, blocking call done),
+    // from this thread it takes the lifo slot and runs after the current task,
+    // else it is resumed on the next tick ahead of the queued tasks
+    void resume_in_context(std::coroutine_handle<>);
+
 #endif
     template<typename Rep, typename Per>
     TimerHandle expires_after(const std::chrono::duration<Rep, Per>& dur, TimerTask&& task) {
@@ -54,18 +79,87 @@ public:
 
     bool assert_in_context_thread();
 
+    // queued tasks + inflight io, published every tick,
+    // readable from any thread
+    size_t load() const {
+        return load_.load(std::memory_order_relaxed);
+    }
+
+    // counts a task handed to this context before the next tick publishes it
+    void add_load(size_t n = 1) {
+        load_.fetch_add(n, std::memory_order_relaxed);
+    }
+
     IoService get_service() const;
 
+    // readable from any thread
+    CoroContextStats stats() const;
+
 private:
     void wake_up();
 
-    std::mutex mutex_;
+    // runs the continuations queued so far
+    void run_continuations();
+
+    // runs the lifo slot up to lifo_cap_ times in a row
+    void run_lifo_slot();
+
+    // spins on the io service and the queues, true if it found work
+    bool busy_poll(TimerClock::duration limit);
+
+#ifdef MAGIO_USE_CORO
+    // stealable if work stealing is on, it has not touched any io yet
+    void spawn_handle(std::coroutine_handle<>);
+#endif
+
+    // wakes this context up if it sleeps, else an idle peer once a backlog builds
+    void push_stealable(Task&& task);
+
+    // moves half of a peer's stealable tasks into local_tasks_
+    bool steal();
+
+    // lock free queue, then wakes the context up if it is sleeping
+    void push_task(Task&& task);
+
+    // from another context's thread, through its ring straight into this one
+    void send_task(Task&& task);
 
     State state_ = Stopping;
+    // the loop is (about to be) blocked in poll and needs a wake up
+    std::atomic<bool> sleeping_{false};
+    std::atomic<size_t> load_{0};
     size_t thread_id_;
-    std::vector<Task> pending_handles_;
+    // posted from this thread, no synchronization
+    std::vector<Task> local_tasks_;
+    // posted from other threads
+    MpscQueue<Task> remote_tasks_;
     TimerQueue timer_queue_;
     std::unique_ptr<IoServiceInterface> io_service_;
+    // the io service can not deliver messages, send_task falls back to push_task
+    bool no_message_ = false;
+
+    // tasks run per tick, 0 -> all
+    size_t task_budget_;
+#ifdef MAGIO_USE_CORO
+    std::vector<std::coroutine_handle<>> continuations_;
+    std::vector<std::coroutine_handle<>> running_continuations_;
+    std::coroutine_handle<> lifo_slot_;
+    unsigned lifo_cap_;
+    MpscQueue<std::coroutine_handle<>> remote_continuations_;
+#endif
+
+    // busy poll, the stats are only written by the context thread
+    uint64_t max_spin_ns_;
+    std::atomic<uint64_t> spin_ns_;
+    std::atomic<uint64_t> spin_total_ns_{0};
+    std::atomic<uint64_t> spins_{0};
+    std::atomic<uint64_t> spin_hits_{0};
+
+    // work stealing, set by the pool before the contexts start
+    std::vector<CoroContext*> peers_;
+    size_t steal_idx_ = 0;
+    std::mutex steal_mutex_;
+    std::deque<Task> stealable_;
 };
 
 }
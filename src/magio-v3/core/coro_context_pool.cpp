@@ -1,27 +1,86 @@
 #include "magio-v3/core/coro_context_pool.h"
 
 #include <thread>
+#include <random>
 
 #include "magio-v3/utils/logger.h"
+#include "magio-v3/net/acceptor.h"
 
 namespace magio {
 
+size_t RoundRobin::select(const Contexts& contexts) {
+    return next_.fetch_add(1, std::memory_order_relaxed) % contexts.size();
+}
+
+size_t LeastLoaded::select(const Contexts& contexts) {
+    size_t idx = 0;
+    size_t min_load = contexts[0]->load();
+    for (size_t i = 1; i < contexts.size() && min_load != 0; ++i) {
+        if (size_t load = contexts[i]->load(); load < min_load) {
+            idx = i;
+            min_load = load;
+        }
+    }
+    return idx;
+}
+
+size_t PowerOfTwoChoices::select(const Contexts& contexts) {
+    if (contexts.size() == 1) {
+        return 0;
+    }
+
+    static thread_local std::minstd_rand engine(std::random_device{}());
+    size_t a = engine() % contexts.size();
+    // another one than a
+    size_t b = (a + 1 + engine() % (contexts.size() - 1)) % contexts.size();
+    return contexts[b]->load() < contexts[a]->load() ? b : a;
+}
+
 CoroContextPool::CoroContextPool(size_t num, size_t every)
-    : every_entries_(every)
+    : CoroContextPool(num, CoroContextOptions{.entries = (unsigned)every})
+{ }
+
+CoroContextPool::CoroContextPool(size_t num, const CoroContextOptions& every, const CoroContextPoolOptions& pool_options)
+    : every_options_(every)
     , thread_id_(CurrentThread::get_id())
     , build_ctx_wg_(num - 1)
     , start_wg_(1)
     , contexts_(num)
+    , cpus_(pool_options.affinity.resolve(num))
 {
     if (num < 1) {
         M_FATAL("{}", "num must >= 1");
     }
 
+    bind_cpus(0);
     contexts_[0] = std::make_unique<CoroContext>(every);
     for (size_t i = 1; i < contexts_.size(); ++i) {
         threads_.emplace_back(&CoroContextPool::run_in_background, this, i);
     }
     build_ctx_wg_.wait();
+
+    switch (pool_options.selection) {
+    case ContextSelection::RoundRobin:
+        policy_ = std::make_unique<RoundRobin>();
+        break;
+    case ContextSelection::LeastLoaded:
+        policy_ = std::make_unique<LeastLoaded>();
+        break;
+    case ContextSelection::PowerOfTwoChoices:
+        policy_ = std::make_unique<PowerOfTwoChoices>();
+        break;
+    }
+
+    // the contexts wait on start_wg_, so they see their peers
+    if (pool_options.work_stealing && num > 1) {
+        for (auto& ctx : contexts_) {
+            for (auto& peer : contexts_) {
+                if (peer != ctx) {
+                    ctx->peers_.push_back(peer.get());
+                }
+            }
+        }
+    }
 }
 
 CoroContextPool::~CoroContextPool() {
@@ -54,23 +113,68 @@ void CoroContextPool::start_all() {
 }
 
 CoroContext& CoroContextPool::next_context() {
-    size_t old = next_idx_;
-    next_idx_ = (next_idx_ + 1) % contexts_.size();
-    return *contexts_[old];
+    auto& ctx = *contexts_[policy_->select(contexts_) % contexts_.size()];
+    // the picks before its next tick spread out
+    ctx.add_load();
+    return ctx;
+}
+
+void CoroContextPool::set_selection_policy(std::unique_ptr<SelectionPolicy> policy) {
+    if (state_ != Stopping) {
+        M_FATAL("{}", "The selection policy must be set before start_all");
+    }
+
+    policy_ = std::move(policy);
 }
 
 CoroContext& CoroContextPool::get(size_t i) {
     return *contexts_[i % contexts_.size()];
 }
 
+Result<std::vector<net::Acceptor>> CoroContextPool::listen(const net::InetAddress& address, bool steer_by_cpu) {
+    std::error_code ec;
+    std::vector<net::Acceptor> acceptors;
+    for (size_t i = 0; i < contexts_.size(); ++i) {
+        acceptors.push_back(net::Acceptor::listen(address, true) | redirect_err(ec));
+        if (ec) {
+            return {ec};
+        }
+    }
+
+    // the program belongs to the group, any listener can attach it.
+    // by the cpus each context is pinned to, unpinned ones get cpu % size
+    if (steer_by_cpu) {
+        acceptors[0].steer_by_cpu(cpus_) | redirect_err(ec);
+        if (ec) {
+            return {ec};
+        }
+    }
+
+    return {std::move(acceptors)};
+}
+
 void CoroContextPool::run_in_background(size_t id) {
-    contexts_[id] = std::make_unique<CoroContext>(every_entries_);
+    // before the context, so its memory is allocated on this node
+    bind_cpus(id);
+    contexts_[id] = std::make_unique<CoroContext>(every_options_);
     build_ctx_wg_.done();
     start_wg_.wait();
     contexts_[id]->start();
     M_TRACE("{}", "One thread exits from multi contexts");
 }
 
+void CoroContextPool::bind_cpus(size_t id) {
+    if (cpus_[id].empty()) {
+        return;
+    }
+
+    std::error_code ec;
+    bind_this_thread(cpus_[id], ec);
+    if (ec) {
+        M_WARN("Context {} cannot be pinned: {}", id, ec.message());
+    }
+}
+
 bool CoroContextPool::assert_in_self_thread() {
     return thread_id_ == CurrentThread::get_id();
 }
@@ -2,10 +2,49 @@
 #define MAGIO_CORE_CORO_CONTEXT_POOL_H_
 
 #include "magio-v3/utils/wait_group.h"
+#include "magio-v3/core/error.h"
 #include "magio-v3/core/coro_context.h"
 
 namespace magio {
 
+namespace net {
+
+class Acceptor;
+
+class InetAddress;
+
+}
+
+// picks the context of the next connection, called from any thread
+class SelectionPolicy {
+public:
+    using Contexts = std::vector<std::unique_ptr<CoroContext>>;
+
+    virtual ~SelectionPolicy() = default;
+
+    // returns an index of contexts
+    virtual size_t select(const Contexts& contexts) = 0;
+};
+
+class RoundRobin: public SelectionPolicy {
+public:
+    size_t select(const Contexts& contexts) override;
+
+private:
+    std::atomic<size_t> next_{0};
+};
+
+class LeastLoaded: public SelectionPolicy {
+public:
+    size_t select(const Contexts& contexts) override;
+};
+
+// does not scan every context and does not make all callers pick the same one
+class PowerOfTwoChoices: public SelectionPolicy {
+public:
+    size_t select(const Contexts& contexts) override;
+};
+
 class CoroContextPool: Noncopyable {
 public:
     // --> singel direct
@@ -15,27 +54,45 @@ public:
 
     CoroContextPool(size_t num, size_t every_entries);
 
+    CoroContextPool(size_t num, const CoroContextOptions& every_options, const CoroContextPoolOptions& pool_options = {});
+
     ~CoroContextPool();
 
     void start_all();
 
+    // chosen by the selection policy, thread safe
     CoroContext& next_context();
 
+    // replaces the policy of the options, must be called before start_all
+    void set_selection_policy(std::unique_ptr<SelectionPolicy> policy);
+
     CoroContext& get(size_t i);
 
+    // one SO_REUSEPORT listener per context, the i-th one must only be used
+    // on get(i), e.g. get(i).spawn(serve(std::move(acceptors[i]))).
+    // steer_by_cpu: the kernel hands a connection to the listener of the
+    // context pinned to the cpu that received it (Acceptor::steer_by_cpu), 
+    // a cpu no context is pinned to picks listener cpu % size
+    [[nodiscard]]
+    Result<std::vector<net::Acceptor>> listen(const net::InetAddress& address, bool steer_by_cpu = false);
+
 private:
     void run_in_background(size_t id);
 
+    // pins the calling thread to the cpus of context id
+    void bind_cpus(size_t id);
+
     bool assert_in_self_thread();
     
     State state_ = Stopping;
-    size_t every_entries_ = 0;
-    size_t next_idx_ = 0;
+    CoroContextOptions every_options_;
+    std::unique_ptr<SelectionPolicy> policy_;
     size_t thread_id_ = 0;
     WaitGroup build_ctx_wg_;
     WaitGroup start_wg_;
     std::vector<std::unique_ptr<CoroContext>> contexts_;
     std::vector<std::thread> threads_;
+    std::vector<std::vector<int>> cpus_;
 };
 
 }
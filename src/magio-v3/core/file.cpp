@@ -153,6 +153,7 @@ RandomAccessFile::~RandomAccessFile() {
 
 RandomAccessFile::RandomAccessFile(RandomAccessFile&& other) noexcept
     : handle_(other.handle_)
+    , attached_(other.attached_)
     , enable_app_(other.enable_app_)
 {
     other.reset();
@@ -160,6 +161,7 @@ RandomAccessFile::RandomAccessFile(RandomAccessFile&& other) noexcept
 
 RandomAccessFile& RandomAccessFile::operator=(RandomAccessFile&& other) noexcept {
     handle_ = other.handle_;
+    attached_ = other.attached_;
     enable_app_ = other.enable_app_;
     other.reset();
     return *this;
@@ -182,7 +184,15 @@ void RandomAccessFile::cancel() {
 
 void RandomAccessFile::close() {
     if (handle_.a != kInvalidHandle) {
-        detail::close_file(handle_);
+        if (attached_) {
+            // on the thread of its context, see Socket::close
+            attached_->dispatch([service = attached_->get_service(), handle = handle_]() mutable {
+                service.detach(handle);
+                detail::close_file(handle);
+            });
+        } else {
+            detail::close_file(handle_);
+        }
         reset();
     }
 }
@@ -200,21 +210,18 @@ void RandomAccessFile::sync_data() {
 }
 
 #ifdef MAGIO_USE_CORO
-Coro<Result<size_t>> RandomAccessFile::read_at(size_t offset, char *buf, size_t len) {
+Coro<Result<size_t>> RandomAccessFile::read_at(size_t offset, char *buf, size_t len, Deadline deadline) {
     attach_context();
-    ResumeHandle rh;
-
-    co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
-        rh.handle = h;
-        this_context::get_service().read_file(handle_, buf, len, offset, &rh, resume_callback);
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().read_file(ioc, handle_, buf, len, offset, ptr, cb, deadline);
     });
+    auto ec = co_await awaiter;
 
-    co_return {rh.res, rh.ec};
+    co_return {awaiter.context().res, ec};
 }
 
 Coro<Result<size_t>> RandomAccessFile::write_at(size_t offset, const char *msg, size_t len) {
     attach_context();
-    ResumeHandle rh;
 
 #ifdef _WIN32
     if (enable_app_) {
@@ -224,16 +231,40 @@ Coro<Result<size_t>> RandomAccessFile::write_at(size_t offset, const char *msg,
     }
 #endif
 
-    co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
-        rh.handle = h;
-        this_context::get_service().write_file(handle_, msg, len, offset, &rh, resume_callback);
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().write_file(ioc, handle_, msg, len, offset, ptr, cb);
+    });
+    auto ec = co_await awaiter;
+
+    co_return {awaiter.context().res, ec};
+}
+
+Coro<Result<size_t>> RandomAccessFile::readv_at(size_t offset, std::span<const IoVec> bufs) {
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().readv_file(ioc, handle_, bufs.data(), bufs.size(), offset, ptr, cb);
     });
+    auto ec = co_await awaiter;
 
-    co_return {rh.res, rh.ec};
+    co_return {awaiter.context().res, ec};
+}
+
+Coro<Result<size_t>> RandomAccessFile::writev_at(size_t offset, std::span<const IoVec> bufs) {
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().writev_file(ioc, handle_, bufs.data(), bufs.size(), offset, ptr, cb);
+    });
+    auto ec = co_await awaiter;
+
+    co_return {awaiter.context().res, ec};
 }
 #endif
 
 void RandomAccessFile::read_at(size_t offset, char *buf, size_t len, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    read_at(offset, buf, len, Deadline{}, std::move(completion_cb));
+}
+
+void RandomAccessFile::read_at(size_t offset, char *buf, size_t len, Deadline deadline, Functor<void (std::error_code, size_t)> &&completion_cb) {
     using Cb = Functor<void (std::error_code, size_t)>;
     attach_context();
 
@@ -243,7 +274,7 @@ void RandomAccessFile::read_at(size_t offset, char *buf, size_t len, Functor<voi
             (*cb)(ec, ioc->res);
             delete cb;
             delete ioc;
-        });
+        }, deadline);
 }
 
 void RandomAccessFile::write_at(size_t offset, const char *msg, size_t len, Functor<void (std::error_code, size_t)> &&completion_cb) {
@@ -267,6 +298,32 @@ void RandomAccessFile::write_at(size_t offset, const char *msg, size_t len, Func
         });
 }
 
+void RandomAccessFile::readv_at(size_t offset, std::span<const IoVec> bufs, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, size_t)>;
+    attach_context();
+
+    this_context::get_service().readv_file(handle_, bufs.data(), bufs.size(), offset, new Cb(std::move(completion_cb)),
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto cb = (Cb*)ptr;
+            (*cb)(ec, ioc->res);
+            delete cb;
+            delete ioc;
+        });
+}
+
+void RandomAccessFile::writev_at(size_t offset, std::span<const IoVec> bufs, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, size_t)>;
+    attach_context();
+
+    this_context::get_service().writev_file(handle_, bufs.data(), bufs.size(), offset, new Cb(std::move(completion_cb)),
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto cb = (Cb*)ptr;
+            (*cb)(ec, ioc->res);
+            delete cb;
+            delete ioc;
+        });
+}
+
 void RandomAccessFile::reset() {
     handle_.a = kInvalidHandle;
     attached_ = nullptr;
@@ -338,40 +395,70 @@ void File::cancel() {
 
 void File::close() {
     if (kInvalidHandle != handle_.a) {
-        detail::close_file(handle_);
+        if (attached_) {
+            // on the thread of its context, see Socket::close
+            attached_->dispatch([service = attached_->get_service(), handle = handle_]() mutable {
+                service.detach(handle);
+                detail::close_file(handle);
+            });
+        } else {
+            detail::close_file(handle_);
+        }
         reset();
     }
 }
 
 #ifdef MAGIO_USE_CORO
-Coro<Result<size_t>> File::read(char *buf, size_t len) {
+Coro<Result<size_t>> File::read(char *buf, size_t len, Deadline deadline) {
     attach_context();
-    ResumeHandle rh;
-
-    co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
-        rh.handle = h;
-        this_context::get_service().read_file(handle_, buf, len, read_offset_, &rh, resume_callback);
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().read_file(ioc, handle_, buf, len, read_offset_, ptr, cb, deadline);
     });
+    auto ec = co_await awaiter;
 
-    read_offset_ += rh.res;
-    co_return {rh.res, rh.ec};
+    read_offset_ += awaiter.context().res;
+    co_return {awaiter.context().res, ec};
 }
 
 Coro<Result<size_t>> File::write(const char *msg, size_t len) {
     attach_context();
-    ResumeHandle rh;
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().write_file(ioc, handle_, msg, len, write_offset_, ptr, cb);
+    });
+    auto ec = co_await awaiter;
 
-    co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
-        rh.handle = h;
-        this_context::get_service().write_file(handle_, msg, len, write_offset_, &rh, resume_callback);
+    write_offset_ += awaiter.context().res;
+    co_return {awaiter.context().res, ec};
+}
+
+Coro<Result<size_t>> File::readv(std::span<const IoVec> bufs) {
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().readv_file(ioc, handle_, bufs.data(), bufs.size(), read_offset_, ptr, cb);
     });
+    auto ec = co_await awaiter;
 
-    write_offset_ += rh.res;
-    co_return {rh.res, rh.ec};
+    read_offset_ += awaiter.context().res;
+    co_return {awaiter.context().res, ec};
+}
+
+Coro<Result<size_t>> File::writev(std::span<const IoVec> bufs) {
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().writev_file(ioc, handle_, bufs.data(), bufs.size(), write_offset_, ptr, cb);
+    });
+    auto ec = co_await awaiter;
+
+    write_offset_ += awaiter.context().res;
+    co_return {awaiter.context().res, ec};
 }
 #endif
 
 void File::read(char *buf, size_t len, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    read(buf, len, Deadline{}, std::move(completion_cb));
+}
+
+void File::read(char *buf, size_t len, Deadline deadline, Functor<void (std::error_code, size_t)> &&completion_cb) {
     using Cb = Functor<void (std::error_code, size_t)>;
     attach_context();
     struct FileResume {
@@ -387,7 +474,7 @@ void File::read(char *buf, size_t len, Functor<void (std::error_code, size_t)> &
             (fr->cb)(ec, ioc->res);
             delete fr;
             delete ioc;
-        });
+        }, deadline);
 }
 
 void File::write(const char *msg, size_t len, Functor<void (std::error_code, size_t)> &&completion_cb) {
@@ -409,6 +496,44 @@ void File::write(const char *msg, size_t len, Functor<void (std::error_code, siz
         });
 }
 
+void File::readv(std::span<const IoVec> bufs, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, size_t)>;
+    attach_context();
+    struct FileResume {
+        Cb cb;
+        File* pfile;
+    };
+    auto fr = new FileResume{.cb = std::move(completion_cb), .pfile = this};
+
+    this_context::get_service().readv_file(handle_, bufs.data(), bufs.size(), read_offset_, fr,
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto fr = (FileResume*)ptr;
+            fr->pfile->read_offset_ += ioc->res;
+            (fr->cb)(ec, ioc->res);
+            delete fr;
+            delete ioc;
+        });
+}
+
+void File::writev(std::span<const IoVec> bufs, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, size_t)>;
+    attach_context();
+    struct FileResume {
+        Cb cb;
+        File* pfile;
+    };
+    auto fr = new FileResume{.cb = std::move(completion_cb), .pfile = this};
+
+    this_context::get_service().writev_file(handle_, bufs.data(), bufs.size(), write_offset_, fr,
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto fr = (FileResume*)ptr;
+            fr->pfile->write_offset_ += ioc->res;
+            (fr->cb)(ec, ioc->res);
+            delete fr;
+            delete ioc;
+        });
+}
+
 void File::sync_all() {
     if (kInvalidHandle != handle_.a) {
         detail::file_sync_all(handle_);
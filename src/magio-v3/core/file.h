@@ -1,10 +1,13 @@
 #ifndef MAGIO_CORE_FILE_H_
 #define MAGIO_CORE_FILE_H_
 
+#include <span>
+
 #include "magio-v3/utils/functor.h"
 #include "magio-v3/utils/noncopyable.h"
 #include "magio-v3/core/error.h"
 #include "magio-v3/core/common.h"
+#include "magio-v3/core/io_service.h"
 
 namespace magio {
 
@@ -46,16 +49,30 @@ public:
 
 #ifdef MAGIO_USE_CORO
     [[nodiscard]]
-    Coro<Result<size_t>> read_at(size_t offset, char* buf, size_t len);
+    Coro<Result<size_t>> read_at(size_t offset, char* buf, size_t len, Deadline deadline = {});
 
     [[nodiscard]]
     Coro<Result<size_t>> write_at(size_t offset, const char* msg, size_t len);
+
+    // scatter/gather, one readv/writev for the whole span
+    [[nodiscard]]
+    Coro<Result<size_t>> readv_at(size_t offset, std::span<const IoVec> bufs);
+
+    [[nodiscard]]
+    Coro<Result<size_t>> writev_at(size_t offset, std::span<const IoVec> bufs);
 #endif
 
     void read_at(size_t offset, char* buf, size_t len, Functor<void(std::error_code, size_t)>&& completion_cb);
 
+    void read_at(size_t offset, char* buf, size_t len, Deadline deadline, Functor<void(std::error_code, size_t)>&& completion_cb);
+
     void write_at(size_t offset, const char* msg, size_t len, Functor<void(std::error_code, size_t)>&& completion_cb);
 
+    // bufs must stay valid until completion_cb is invoked
+    void readv_at(size_t offset, std::span<const IoVec> bufs, Functor<void(std::error_code, size_t)>&& completion_cb);
+
+    void writev_at(size_t offset, std::span<const IoVec> bufs, Functor<void(std::error_code, size_t)>&& completion_cb);
+
     void sync_all();
 
     void sync_data();
@@ -106,16 +123,29 @@ public:
 
 #ifdef MAGIO_USE_CORO
     [[nodiscard]]
-    Coro<Result<size_t>> read(char* buf, size_t len);
+    Coro<Result<size_t>> read(char* buf, size_t len, Deadline deadline = {});
     
     [[nodiscard]]
     Coro<Result<size_t>> write(const char* msg, size_t len);
+
+    [[nodiscard]]
+    Coro<Result<size_t>> readv(std::span<const IoVec> bufs);
+
+    [[nodiscard]]
+    Coro<Result<size_t>> writev(std::span<const IoVec> bufs);
 #endif
 
     void read(char* buf, size_t len, Functor<void(std::error_code, size_t)>&& completion_cb);
+
+    void read(char* buf, size_t len, Deadline deadline, Functor<void(std::error_code, size_t)>&& completion_cb);
     
     void write(const char* msg, size_t len, Functor<void(std::error_code, size_t)>&& completion_cb);
 
+    // bufs must stay valid until completion_cb is invoked
+    void readv(std::span<const IoVec> bufs, Functor<void(std::error_code, size_t)>&& completion_cb);
+
+    void writev(std::span<const IoVec> bufs, Functor<void(std::error_code, size_t)>&& completion_cb);
+
     void attach_context();
 
     void sync_all();
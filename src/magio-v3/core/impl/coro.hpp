@@ -74,9 +74,9 @@ inline Coro<RemoveVoidTuple<Ts...>> series(Coro<Ts>...coros) {
     co_await [&]<size_t...Idx>(std::index_sequence<Idx...>) -> Coro<> {
         (co_await [&]() mutable -> Coro<> {
             if constexpr (Idx != (size_t)-1) {
-                std::get<Idx>(result) = co_await coros;
+                std::get<Idx>(result) = co_await std::move(coros);
             } else {
-                co_await coros;
+                co_await std::move(coros);
             }
         }(), ...);
     }(NonVoidPlaceSequence<Ts...>{});
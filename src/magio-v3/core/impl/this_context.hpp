@@ -29,7 +29,7 @@ inline void spawn(Coro<T> coro) {
 
 template<typename T>
 inline Coro<T> spawn(Coro<T> coro, detail::UseCoro) {
-    co_return co_await coro;
+    co_return co_await std::move(coro);
 }
 
 template<typename T>
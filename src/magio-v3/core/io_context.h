@@ -2,9 +2,14 @@
 #ifndef MAGIO_CORE_IO_CONTEXT_H_
 #define MAGIO_CORE_IO_CONTEXT_H_
 
+#include <deque>
+#include <utility>
 #include <system_error>
 
+#include "magio-v3/utils/free_list.h"
+#include "magio-v3/utils/noncopyable.h"
 #include "magio-v3/core/coroutine.h"
+#include "magio-v3/core/io_service.h"
 
 #ifdef _WIN32
 #include <WinSock2.h>
@@ -25,13 +30,15 @@ enum class Operation {
     Send,
     Receive,
     SendTo,
-    ReceiveFrom
-};
-
-// for linux
-struct IoVec {
-    char* buf;
-    size_t len;
+    ReceiveFrom,
+    ReceiveBuffer,
+    AcceptMultishot,
+    SendZeroCopy,
+    WriteFileVectored,
+    ReadFileVectored,
+    SendVectored,
+    ReceiveVectored,
+    Message
 };
 
 #ifdef _WIN32
@@ -44,6 +51,7 @@ inline IoVec io_buf(char* buf, size_t len) {
 }
 #endif
 
+// vectored ops keep the IoVec array in iovec: buf points to it, len is its size
 struct IoContext {
 #ifdef _WIN32
     OVERLAPPED overlapped;
@@ -52,6 +60,7 @@ struct IoContext {
 #elif defined(__linux__)
     Operation op;
     IoVec iovec;
+    __kernel_timespec deadline; // linked timeout, absolute, zero means none
 #endif
     union {
         sockaddr_in remote_addr;
@@ -62,22 +71,44 @@ struct IoContext {
     void(*cb)(std::error_code, IoContext*, void*);
 
     uint64_t res; // sockethandle iohandle bytes
-};
+    uint32_t buf_id; // provided buffer picked by the kernel
+    bool more; // multishot, the op stays armed after this completion
+    uint16_t segment_size; // udp gro, the size of the coalesced datagrams
 
-#ifdef MAGIO_USE_CORO
-struct ResumeHandle {
-    std::error_code ec;
-    uint64_t res;
-    std::coroutine_handle<> handle;
+    // one per op, recycled through a per thread free list
+    static void* operator new(size_t) {
+        return FreeList<IoContext>::allocate();
+    }
+
+    static void operator delete(void* p) {
+        FreeList<IoContext>::deallocate(p);
+    }
 };
 
 #if defined (__linux__)
 struct ResumeWithMsg {
     msghdr msg;
     void* ptr;
+    // UDP_SEGMENT on send, UDP_GRO on receive
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+
+    static void* operator new(size_t) {
+        return FreeList<ResumeWithMsg>::allocate();
+    }
+
+    static void operator delete(void* p) {
+        FreeList<ResumeWithMsg>::deallocate(p);
+    }
 };
 #endif
 
+#ifdef MAGIO_USE_CORO
+struct ResumeHandle {
+    std::error_code ec;
+    uint64_t res;
+    std::coroutine_handle<> handle;
+};
+
 inline void resume_callback(std::error_code ec, IoContext* ioc, void* ptr) {
     auto* h = static_cast<ResumeHandle*>(ptr);
     h->ec = ec;
@@ -85,6 +116,101 @@ inline void resume_callback(std::error_code ec, IoContext* ioc, void* ptr) {
     h->handle.resume();
     delete ioc;
 }
+
+// Owns the IoContext of one op, so awaiting an op allocates nothing 
+// beyond the coroutine frame. start(ioc, ptr, cb) submits the op, 
+// the completion resumes the coroutine with the error code.
+template<typename Start>
+class IoAwaiter: Noncopyable {
+public:
+    IoAwaiter(Start start)
+        : start_(std::move(start))
+    { }
+
+    bool await_ready() {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h) {
+        handle_ = h;
+        start_(ioc_, this, &IoAwaiter::complete);
+    }
+
+    std::error_code await_resume() {
+        return ec_;
+    }
+
+    IoContext& context() {
+        return ioc_;
+    }
+
+private:
+    static void complete(std::error_code ec, IoContext* ioc, void* ptr) {
+        auto self = static_cast<IoAwaiter*>(ptr);
+        self->ec_ = ec;
+        self->handle_.resume();
+    }
+
+    Start start_;
+    IoContext ioc_;
+    std::error_code ec_;
+    std::coroutine_handle<> handle_;
+};
+
+namespace detail {
+
+// queues the completions of a multishot op until a coroutine asks for them
+template<typename T>
+struct MultishotReceiver {
+    using Entry = std::pair<std::error_code, T>;
+
+    void complete(std::error_code ec, IoContext* ioc, T&& value) {
+        bool more = ioc->more;
+        if (!more) {
+            this->ioc = nullptr;
+            delete ioc;
+        }
+
+        if (orphaned && !waiter) {
+            if (!more) {
+                delete this;
+            }
+            return;
+        }
+
+        ready.emplace_back(ec, std::move(value));
+        if (waiter) {
+            std::exchange(waiter, nullptr).resume();
+        }
+    }
+
+    Entry pop() {
+        Entry entry = std::move(ready.front());
+        ready.pop_front();
+        if (orphaned && !ioc) {
+            delete this;
+        }
+        return entry;
+    }
+
+    // the owner is closed, the last completion frees the receiver
+    void drop(IoService service) {
+        if (!ioc) {
+            delete this;
+            return;
+        }
+        orphaned = true;
+        ready.clear();
+        service.cancel(ioc);
+    }
+
+    IoContext* ioc = nullptr;
+    bool orphaned = false;
+    std::deque<Entry> ready;
+    std::coroutine_handle<> waiter;
+};
+
+}
 #endif
 
 }
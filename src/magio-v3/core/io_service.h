@@ -1,8 +1,11 @@
 #ifndef MAGIO_CORE_IO_SERVICE_H_
 #define MAGIO_CORE_IO_SERVICE_H_
 
+#include <chrono>
+#include <cstdint>
 #include <system_error>
 
+#include "magio-v3/utils/noncopyable.h"
 #include "magio-v3/core/common.h"
 #include "magio-v3/net/protocal.h"
 
@@ -18,6 +21,9 @@ class InetAddress;
 
 struct IoContext;
 
+// an absolute point on the steady clock, the default one means no deadline
+using Deadline = std::chrono::steady_clock::time_point;
+
 class IoServiceInterface {
 public:
     using Cb = void(*)(std::error_code, IoContext*, void*);
@@ -28,26 +34,75 @@ public:
 
     virtual void read_file(IoHandle ioh, size_t offset, IoContext* ioc) = 0;
 
+    virtual void writev_file(IoHandle ioh, size_t offset, IoContext* ioc) = 0;
+
+    virtual void readv_file(IoHandle ioh, size_t offset, IoContext* ioc) = 0;
+
     virtual void accept(const net::Socket& listener, IoContext* ioc) = 0;
 
+    // multishot, completes once per accepted connection
+    virtual void accept_multishot(const net::Socket& listener, IoContext* ioc) = 0;
+
     virtual void connect(SocketHandle socket, IoContext* ioc) = 0;
 
     virtual void send(SocketHandle socket, IoContext* ioc) = 0;
 
     virtual void receive(SocketHandle socket, IoContext* ioc) = 0;
 
+    // completes once the kernel no longer references the buffer
+    virtual void send_zc(SocketHandle socket, IoContext* ioc) = 0;
+
+    virtual void sendv(SocketHandle socket, IoContext* ioc) = 0;
+
+    virtual void receivev(SocketHandle socket, IoContext* ioc) = 0;
+
     virtual void send_to(SocketHandle socket, IoContext* ioc) = 0;
 
     virtual void receive_from(SocketHandle socket, IoContext* ioc) = 0;
 
+    // multishot, completes once per message into the provided buffer ring.
+    // ENOBUFS is not reported, the op is armed again when a buffer is released
+    virtual void receive_buffer(SocketHandle socket, IoContext* ioc) = 0;
+
+    virtual void release_buffer(uint32_t buf_id) = 0;
+
     virtual void cancel(IoHandle ioh) = 0;
 
+    virtual void cancel(IoContext* ioc) = 0;
+
     virtual void attach(IoHandle ioh, std::error_code& ec) = 0;
 
+    // must be called before the handle is closed, on the thread polling this service
+    virtual void detach(IoHandle ioh) = 0;
+
+    // hands ioc to the thread polling target through its completion queue, 
+    // cb runs there. if the delivery fails cb runs on this thread with the error
+    virtual void send_message(IoServiceInterface* target, IoContext* ioc) = 0;
+
     // -1->big error, 0->wait timeout; 1->io; 2->continue
     virtual int poll(size_t nanosec, std::error_code& ec) = 0;
 
     virtual void wake_up() = 0;
+
+    // submitted ops not completed yet
+    virtual size_t inflight() const = 0;
+
+    // poll runs it after the cb of each completion
+    void set_completion_hook(void(*hook)(void*), void* ptr) {
+        hook_ = hook;
+        hook_ptr_ = ptr;
+    }
+
+protected:
+    void run_completion_hook() {
+        if (hook_) {
+            hook_(hook_ptr_);
+        }
+    }
+
+private:
+    void(*hook_)(void*) = nullptr;
+    void* hook_ptr_ = nullptr;
 };
 
 class IoService {
@@ -58,26 +113,92 @@ public:
         : impl_(impl)
     { }
 
+    // the overloads taking an IoContext submit the op with the caller's one,
+    // it must stay alive until cb is invoked and cb must not delete it
+
     void write_file(IoHandle ioh, const char* msg, size_t len, size_t offset, void* user_ptr, Cb);
 
-    void read_file(IoHandle ioh, char* buf, size_t len, size_t offset, void* user_ptr, Cb);
+    void write_file(IoContext& ioc, IoHandle ioh, const char* msg, size_t len, size_t offset, void* user_ptr, Cb);
+
+    // the op is canceled by the kernel when the deadline expires, 
+    // cb then gets std::errc::timed_out. iocp can not do that, 
+    // cb gets std::errc::not_supported there if a deadline is given
+    void read_file(IoHandle ioh, char* buf, size_t len, size_t offset, void* user_ptr, Cb, Deadline deadline = {});
+
+    void read_file(IoContext& ioc, IoHandle ioh, char* buf, size_t len, size_t offset, void* user_ptr, Cb, Deadline deadline = {});
+
+    // scatter/gather, bufs must stay valid until cb is invoked
+    void writev_file(IoHandle ioh, const IoVec* bufs, size_t n, size_t offset, void* user_ptr, Cb);
+
+    void writev_file(IoContext& ioc, IoHandle ioh, const IoVec* bufs, size_t n, size_t offset, void* user_ptr, Cb);
+
+    void readv_file(IoHandle ioh, const IoVec* bufs, size_t n, size_t offset, void* user_ptr, Cb);
+
+    void readv_file(IoContext& ioc, IoHandle ioh, const IoVec* bufs, size_t n, size_t offset, void* user_ptr, Cb);
+
+    void accept(const net::Socket& listener, void* user_ptr, Cb, Deadline deadline = {});
+
+    void accept(IoContext& ioc, const net::Socket& listener, void* user_ptr, Cb, Deadline deadline = {});
+
+    // multishot, cb frees the context with the last completion (more == false)
+    void accept_multishot(const net::Socket& listener, void* user_ptr, Cb);
+
+    // the caller's context must come from new, cb frees it with the last completion,
+    // which may run before this returns
+    void accept_multishot(IoContext& ioc, const net::Socket& listener, void* user_ptr, Cb);
 
-    void accept(const net::Socket& listener, void* user_ptr, Cb);
+    void connect(SocketHandle socket, const net::InetAddress& remote, void* user_ptr, Cb, Deadline deadline = {});
 
-    void connect(SocketHandle socket, const net::InetAddress& remote, void* user_ptr, Cb);
+    void connect(IoContext& ioc, SocketHandle socket, const net::InetAddress& remote, void* user_ptr, Cb, Deadline deadline = {});
 
-    void send(SocketHandle socket, const char* msg, size_t len, void* user_ptr, Cb);
+    void send(SocketHandle socket, const char* msg, size_t len, void* user_ptr, Cb, Deadline deadline = {});
 
-    void receive(SocketHandle socket, char* buf, size_t len, void* user_ptr, Cb);
+    void send(IoContext& ioc, SocketHandle socket, const char* msg, size_t len, void* user_ptr, Cb, Deadline deadline = {});
 
-    void send_to(SocketHandle socket, const net::InetAddress& remote, const char* msg, size_t len, void* user_ptr, Cb);
+    void receive(SocketHandle socket, char* buf, size_t len, void* user_ptr, Cb, Deadline deadline = {});
 
+    void receive(IoContext& ioc, SocketHandle socket, char* buf, size_t len, void* user_ptr, Cb, Deadline deadline = {});
+
+    // msg must stay untouched until cb is invoked
+    void send_zc(SocketHandle socket, const char* msg, size_t len, void* user_ptr, Cb);
+
+    void send_zc(IoContext& ioc, SocketHandle socket, const char* msg, size_t len, void* user_ptr, Cb);
+
+    // sendmsg/recvmsg, bufs must stay valid until cb is invoked
+    void sendv(SocketHandle socket, const IoVec* bufs, size_t n, void* user_ptr, Cb);
+
+    void sendv(IoContext& ioc, SocketHandle socket, const IoVec* bufs, size_t n, void* user_ptr, Cb);
+
+    void receivev(SocketHandle socket, const IoVec* bufs, size_t n, void* user_ptr, Cb);
+
+    void receivev(IoContext& ioc, SocketHandle socket, const IoVec* bufs, size_t n, void* user_ptr, Cb);
+
+    // segment_size != 0: udp gso, msg is split into datagrams of segment_size bytes by the kernel,
+    // cb gets std::errc::not_supported on iocp
+    void send_to(SocketHandle socket, const net::InetAddress& remote, const char* msg, size_t len, void* user_ptr, Cb, size_t segment_size = 0);
+
+    // reports the udp gro segment size in IoContext::segment_size, 0 if not coalesced
     void receive_from(SocketHandle socket, char* buf, size_t len, void* user_ptr, Cb);
 
+    // multishot, cb frees the context with the last completion (more == false)
+    void receive_buffer(SocketHandle socket, void* user_ptr, Cb);
+
+    // the caller's context must come from new, cb frees it with the last completion,
+    // which may run before this returns
+    void receive_buffer(IoContext& ioc, SocketHandle socket, void* user_ptr, Cb);
+
+    void release_buffer(uint32_t buf_id);
+
     void cancel(IoHandle ioh);
+
+    void cancel(IoContext* ioc);
     
     void attach(IoHandle ioh, std::error_code& ec);
 
+    void detach(IoHandle ioh);
+
+    void send_message(IoService target, void* user_ptr, Cb);
+
     int poll(size_t nanosec, std::error_code& ec);
 
     void wake_up();
@@ -86,6 +207,39 @@ private:
     IoServiceInterface* impl_;
 };
 
+// A buffer of the provided buffer ring filled by the kernel. 
+// It is given back to the ring on destruction.
+class ProvidedBuffer: Noncopyable {
+public:
+    ProvidedBuffer() = default;
+
+    ProvidedBuffer(IoService service, char* data, size_t len, uint32_t id);
+
+    ~ProvidedBuffer();
+
+    ProvidedBuffer(ProvidedBuffer&& other) noexcept;
+
+    ProvidedBuffer& operator=(ProvidedBuffer&& other) noexcept;
+
+    void release();
+
+    const char* data() const {
+        return data_;
+    }
+
+    size_t size() const {
+        return len_;
+    }
+
+private:
+    void reset();
+
+    IoService service_{nullptr};
+    char* data_ = nullptr;
+    size_t len_ = 0;
+    uint32_t id_ = 0;
+};
+
 }
 
 #endif
\ No newline at end of file
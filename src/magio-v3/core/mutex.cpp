@@ -3,7 +3,7 @@
 namespace magio {
 
 #ifdef MAGIO_USE_CORO
-void Mutex::LockAwaitable::await_suspend(std::coroutine_handle<> prev_h) {
+bool Mutex::LockAwaitable::await_suspend(std::coroutine_handle<> prev_h) {
     bool wake = false;
     {
         std::lock_guard lk(co_mutex_.mutex_);
@@ -14,12 +14,19 @@ void Mutex::LockAwaitable::await_suspend(std::coroutine_handle<> prev_h) {
             co_mutex_.queue_.push_back({LocalContext, prev_h});
         }
     }
-    if (wake) {
-        prev_h.resume();
+    if (!wake) {
+        return true;
     }
+
+    // out of budget, the owner resumes from the run queue
+    if (!detail::consume_coop_budget()) {
+        LocalContext->queue_in_context(prev_h);
+        return true;
+    }
+    return false;
 }
 
-void Mutex::GuardAwaitable::await_suspend(std::coroutine_handle<> prev_h) {
+bool Mutex::GuardAwaitable::await_suspend(std::coroutine_handle<> prev_h) {
     bool wake = false;
     {
         std::lock_guard lk(co_mutex_.mutex_);
@@ -30,9 +37,16 @@ void Mutex::GuardAwaitable::await_suspend(std::coroutine_handle<> prev_h) {
             co_mutex_.queue_.push_back({LocalContext, prev_h});
         }
     }
-    if (wake) {
-        prev_h.resume();
+    if (!wake) {
+        return true;
+    }
+
+    // out of budget, the owner resumes from the run queue
+    if (!detail::consume_coop_budget()) {
+        LocalContext->queue_in_context(prev_h);
+        return true;
     }
+    return false;
 }
 
 LockGuard Mutex::GuardAwaitable::await_resume() {
@@ -63,7 +77,7 @@ void Mutex::unlock() {
         }
     }
     if (entry.h) {
-        entry.ctx->queue_in_context(entry.h);
+        entry.ctx->resume_in_context(entry.h);
     }
 }
 
@@ -77,7 +91,7 @@ void Condition::notify_one() {
         }
     }
     if (entry.h) {
-        entry.ctx->queue_in_context(entry.h);
+        entry.ctx->resume_in_context(entry.h);
     }
 }
 
@@ -89,7 +103,7 @@ void Condition::notify_all() {
     }
 
     for (auto entry : tmp) {
-        entry.ctx->queue_in_context(entry.h);
+        entry.ctx->resume_in_context(entry.h);
     }
 }
 #endif
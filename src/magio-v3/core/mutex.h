@@ -1,6 +1,7 @@
 #ifndef MAGIO_CORE_MUTEX_H_
 #define MAGIO_CORE_MUTEX_H_
 
+#include <mutex>
 #include <atomic>
 
 #include "magio-v3/core/coro_context.h"
@@ -30,7 +31,8 @@ public:
             return false; 
         }
 
-        void await_suspend(std::coroutine_handle<> prev_h);
+        // false: the lock is taken, go on without suspending
+        bool await_suspend(std::coroutine_handle<> prev_h);
 
         void await_resume() { }
 
@@ -48,7 +50,8 @@ public:
             return false; 
         }
 
-        void await_suspend(std::coroutine_handle<> prev_h);
+        // false: the lock is taken, go on without suspending
+        bool await_suspend(std::coroutine_handle<> prev_h);
 
         [[nodiscard]]
         LockGuard await_resume();
@@ -0,0 +1,79 @@
+#ifndef MAGIO_CORE_OPTIONS_H_
+#define MAGIO_CORE_OPTIONS_H_
+
+#include <cstddef>
+
+#include "magio-v3/core/affinity.h"
+
+namespace magio {
+
+struct CoroContextOptions {
+    // size of the submission queue
+    unsigned entries = 128;
+    // 0 -> half of entries, pending sqes are submitted once reaching it
+    unsigned submit_threshold = 0;
+
+    // provided buffer ring used by Socket::receive_buffer, entries must be a power of 2
+    unsigned buffer_ring_entries = 512;
+    unsigned buffer_ring_buffer_size = 4096;
+
+    // size of the sparse fixed file table, 0 -> disabled.
+    // attached sockets, files and pipes take a slot while one is free
+    unsigned fixed_files = 0;
+
+    // io_uring setup flags, ignored on windows.
+    // a kernel thread polls the submission queue, 
+    // it sleeps after sq_thread_idle ms without work.
+    bool sq_poll = false;
+    unsigned sq_thread_idle = 0;
+    // -1 -> not pinned
+    int sq_thread_cpu = -1;
+    // only the context thread submits, which always holds for a context
+    bool single_issuer = false;
+    // completions run when the context waits rather than interrupting it,
+    // requires single_issuer
+    bool defer_taskrun = false;
+    bool coop_taskrun = false;
+
+    // tasks run per tick before timers and io are polled again, the rest 
+    // waits for the next tick. 0 -> every ready task. continuations 
+    // (CoroContext::resume_in_context) are not counted and run first
+    unsigned task_budget = 0;
+
+    // ops (mutex locks, multishot results, co_await Coro) a coroutine may
+    // finish without suspending before it yields to the others, 0 -> unlimited.
+    // plain socket and file ops always suspend on the ring
+    unsigned coop_budget = 128;
+
+    // a coroutine woken on its own context (CoroContext::resume_in_context)
+    // runs right after the current task, while what they share is in cache.
+    // the slot runs at most lifo_cap times in a row, 0 -> no slot
+    unsigned lifo_cap = 3;
+
+    // before blocking for io the context spins on the completion queue for 
+    // up to busy_poll_us, 0 -> disabled. the spin halves after finding nothing
+    // and doubles after finding work, never above busy_poll_us
+    unsigned busy_poll_us = 0;
+};
+
+// how CoroContextPool::next_context picks a context
+enum class ContextSelection {
+    RoundRobin,
+    // the lowest CoroContext::load()
+    LeastLoaded,
+    // the lower load of two random contexts
+    PowerOfTwoChoices,
+};
+
+struct CoroContextPoolOptions {
+    ContextSelection selection = ContextSelection::RoundRobin;
+    // a context about to sleep takes half of the spawned but not yet 
+    // started coroutines of a busy peer. spawns then take a lock
+    bool work_stealing = false;
+    // context i runs on thread i, context 0 on the thread building the pool
+    CpuAffinity affinity;
+};
+
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include "magio-v3/core/pipe.h"
 
+#include "magio-v3/utils/logger.h"
 #include "magio-v3/core/error.h"
 #include "magio-v3/core/io_context.h"
 #include "magio-v3/core/coro_context.h"
@@ -12,6 +13,27 @@
 
 namespace magio {
 
+static void close_pipe(IoHandle ioh) {
+#ifdef _WIN32
+    ::CloseHandle(ioh.ptr);
+#elif defined (__linux__)
+    ::close(ioh.a);
+#endif
+}
+
+// on the thread of the context it is attached to, see Socket::close
+static void close_pipe(CoroContext* attached, IoHandle ioh) {
+    if (!attached) {
+        close_pipe(ioh);
+        return;
+    }
+
+    attached->dispatch([service = attached->get_service(), ioh]() mutable {
+        service.detach(ioh);
+        close_pipe(ioh);
+    });
+}
+
 ReadablePipe::~ReadablePipe() {
     close();
 }
@@ -22,31 +44,35 @@ ReadablePipe::ReadablePipe(Handle handle)
 
 ReadablePipe::ReadablePipe(ReadablePipe&& other) noexcept
     : handle_(other.handle_)
+    , attached_(other.attached_)
 {
     other.handle_.a = kInvalidHandle;
+    other.attached_ = nullptr;
 }
 
 ReadablePipe& ReadablePipe::operator=(ReadablePipe &&other) noexcept {
     handle_ = other.handle_;
+    attached_ = other.attached_;
     other.handle_.a = kInvalidHandle;
+    other.attached_ = nullptr;
     return *this;
 }
 
 #ifdef MAGIO_USE_CORO
 Coro<Result<size_t>> ReadablePipe::read(char *buf, size_t len) {
-    ResumeHandle rh;
-
-    co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
-        rh.handle = h;
-        this_context::get_service().read_file(handle_, buf, len, 0, &rh, resume_callback);
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().read_file(ioc, handle_, buf, len, 0, ptr, cb);
     });
+    auto ec = co_await awaiter;
 
-    co_return {rh.res, rh.ec};
+    co_return {awaiter.context().res, ec};
 }
 #endif
 
 void ReadablePipe::read(char *buf, size_t len, Functor<void (std::error_code, size_t)>&& cb) {
     using Cb = Functor<void (std::error_code, size_t)>;
+    attach_context();
 
     this_context::get_service().read_file(handle_, buf, len, 0, new Cb(std::move(cb)), 
         [](std::error_code ec, IoContext* ioc, void* ptr) {
@@ -59,12 +85,23 @@ void ReadablePipe::read(char *buf, size_t len, Functor<void (std::error_code, si
 
 void ReadablePipe::close() {
     if (handle_.a != kInvalidHandle) {
-#ifdef _WIN32
-        ::CloseHandle(handle_.ptr);
-#elif defined (__linux__)
-        ::close(handle_.a);
-#endif
+        close_pipe(attached_, handle_);
         handle_.a = kInvalidHandle;
+        attached_ = nullptr;
+    }
+}
+
+void ReadablePipe::attach_context() {
+    if (kInvalidHandle == handle_.a) {
+        return;
+    }
+
+    if (!attached_) {
+        std::error_code ec;
+        attached_ = LocalContext;
+        this_context::get_service().attach(handle_, ec);
+    } else if (attached_ != LocalContext) {
+        M_FATAL("{}", "The pipe cannot be attached to different context");
     }
 }
 
@@ -78,31 +115,35 @@ WritablePipe::~WritablePipe() {
 
 WritablePipe::WritablePipe(WritablePipe&& other) noexcept
     : handle_(other.handle_)
+    , attached_(other.attached_)
 {
     other.handle_.a = kInvalidHandle;
+    other.attached_ = nullptr;
 }
 
 WritablePipe& WritablePipe::operator=(WritablePipe &&other) noexcept {
     handle_ = other.handle_;
+    attached_ = other.attached_;
     other.handle_.a = kInvalidHandle;
+    other.attached_ = nullptr;
     return *this;
 }
 
 #ifdef MAGIO_USE_CORO
 Coro<Result<size_t>> WritablePipe::write(const char *msg, size_t len) {
-    ResumeHandle rh;
-
-    co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
-        rh.handle = h;
-        this_context::get_service().write_file(handle_, msg, len, 0, &rh, resume_callback);
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().write_file(ioc, handle_, msg, len, 0, ptr, cb);
     });
+    auto ec = co_await awaiter;
 
-    co_return {rh.res, rh.ec};
+    co_return {awaiter.context().res, ec};
 }
 #endif
 
 void WritablePipe::write(const char *msg, size_t len, Functor<void (std::error_code, size_t)> &&cb) {
     using Cb = Functor<void (std::error_code, size_t)>;
+    attach_context();
 
     this_context::get_service().write_file(handle_, msg, len, 0, new Cb(std::move(cb)), 
         [](std::error_code ec, IoContext* ioc, void* ptr) {
@@ -115,12 +156,23 @@ void WritablePipe::write(const char *msg, size_t len, Functor<void (std::error_c
 
 void WritablePipe::close() {
     if (handle_.a != kInvalidHandle) {
-#ifdef _WIN32
-        ::CloseHandle(handle_.ptr);
-#elif defined (__linux__)
-        ::close(handle_.a);
-#endif
+        close_pipe(attached_, handle_);
         handle_.a = kInvalidHandle;
+        attached_ = nullptr;
+    }
+}
+
+void WritablePipe::attach_context() {
+    if (kInvalidHandle == handle_.a) {
+        return;
+    }
+
+    if (!attached_) {
+        std::error_code ec;
+        attached_ = LocalContext;
+        this_context::get_service().attach(handle_, ec);
+    } else if (attached_ != LocalContext) {
+        M_FATAL("{}", "The pipe cannot be attached to different context");
     }
 }
 
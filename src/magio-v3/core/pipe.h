@@ -8,6 +8,8 @@
 
 namespace magio {
 
+class CoroContext;
+
 template<typename>
 class Coro;
 
@@ -36,6 +38,8 @@ public:
 
     void close();
 
+    void attach_context();
+
     operator bool() {
         return handle_.a != kInvalidHandle;
     }
@@ -44,6 +48,7 @@ private:
     ReadablePipe(Handle);
 
     Handle handle_{.a = kInvalidHandle};
+    CoroContext* attached_ = nullptr;
 };
 
 class WritablePipe: Noncopyable {
@@ -69,6 +74,8 @@ public:
 
     void close();
 
+    void attach_context();
+
     operator bool() {
         return handle_.a != kInvalidHandle;
     }
@@ -77,6 +84,7 @@ private:
     WritablePipe(Handle);
 
     Handle handle_{.a = kInvalidHandle};
+    CoroContext* attached_ = nullptr;
 };
 
 Result<std::tuple<ReadablePipe, WritablePipe>> make_pipe();
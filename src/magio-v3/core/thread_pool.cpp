@@ -4,9 +4,10 @@
 
 namespace magio {
 
-ThreadPool::ThreadPool(CoroContext& bind_ctx, size_t thread_num)
+ThreadPool::ThreadPool(CoroContext& bind_ctx, size_t thread_num, const CpuAffinity& affinity)
     : ctx_(bind_ctx)
     , threads_(thread_num) 
+    , cpus_(affinity.resolve(thread_num))
 {
     if (thread_num < 1) {
         M_FATAL("{}", "worker threads cannot less than 1");
@@ -30,8 +31,8 @@ ThreadPool::~ThreadPool() {
 
 void ThreadPool::start() {
     std::call_once(once_flag_, [&] {
-        for (auto& th : threads_) {
-            th = std::thread(&ThreadPool::run_in_background, this);
+        for (size_t i = 0; i < threads_.size(); ++i) {
+            threads_[i] = std::thread(&ThreadPool::run_in_background, this, i);
         }
     });
 
@@ -68,7 +69,15 @@ void ThreadPool::execute(Task &&task) {
     cv_.notify_one();
 }
 
-void ThreadPool::run_in_background() {
+void ThreadPool::run_in_background(size_t id) {
+    if (!cpus_[id].empty()) {
+        std::error_code ec;
+        bind_this_thread(cpus_[id], ec);
+        if (ec) {
+            M_WARN("Worker {} cannot be pinned: {}", id, ec.message());
+        }
+    }
+
     Task task;
 
     for (; ;) {
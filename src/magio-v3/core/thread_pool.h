@@ -1,6 +1,7 @@
 #ifndef MAGIO_CORE_THREAD_POOL_H_
 #define MAGIO_CORE_THREAD_POOL_H_
 
+#include <mutex>
 #include <thread>
 #include <optional>
 #include <condition_variable>
@@ -8,6 +9,7 @@
 #include "magio-v3/utils/noncopyable.h"
 #include "magio-v3/core/coro_context.h"
 #include "magio-v3/core/execution.h"
+#include "magio-v3/core/affinity.h"
 
 namespace magio {
 
@@ -24,7 +26,7 @@ public:
         PendingDestroy
     };
 
-    ThreadPool(CoroContext& bind_ctx, size_t thread_num);
+    ThreadPool(CoroContext& bind_ctx, size_t thread_num, const CpuAffinity& affinity = {});
 
     ~ThreadPool();
 
@@ -103,7 +105,7 @@ public:
                             return func(args...);
                         }, tuple));
                     }
-                    ctx_.queue_in_context(h);
+                    ctx_.resume_in_context(h);
                 });
             }
         );
@@ -126,7 +128,7 @@ public:
 #endif
 
 private:
-    void run_in_background();
+    void run_in_background(size_t id);
 
     CoroContext& ctx_;
     std::once_flag once_flag_;
@@ -140,6 +142,7 @@ private:
     std::deque<Task> tasks_;
 
     std::vector<std::thread> threads_;
+    std::vector<std::vector<int>> cpus_;
 };
 
 }
@@ -4,26 +4,58 @@
 #include "magio-v3/core/io_context.h"
 #include "magio-v3/net/address.h"
 
+#ifdef __linux__
+#include <linux/filter.h>
+#endif
+
 namespace magio {
 
 namespace net {
 
+#ifdef MAGIO_USE_CORO
+// the cancel goes to the ring of the listener's context, on its thread
+template<typename Receiver>
+static void drop_receiver(CoroContext* attached, Receiver* receiver) {
+    attached->dispatch([service = attached->get_service(), receiver] {
+        receiver->drop(service);
+    });
+}
+#endif
+
 Acceptor::Acceptor() { }
 
+Acceptor::~Acceptor() {
+#ifdef MAGIO_USE_CORO
+    if (receiver_) {
+        drop_receiver(listener_.attached_, receiver_);
+    }
+#endif
+}
+
 Acceptor::Acceptor(Acceptor&& other) noexcept
     : listener_(std::move(other.listener_)) 
-{ }
+    , receiver_(other.receiver_)
+{ 
+    other.receiver_ = nullptr;
+}
 
 Acceptor& Acceptor::operator=(Acceptor&& other) noexcept {
     if (listener_.handle() == other.listener_.handle()) { // self
         return *this;
     }
 
+#ifdef MAGIO_USE_CORO
+    if (receiver_) {
+        drop_receiver(listener_.attached_, receiver_);
+    }
+#endif
     listener_ = std::move(other.listener_);
+    receiver_ = other.receiver_;
+    other.receiver_ = nullptr;
     return *this;
 }
 
-Result<Acceptor> Acceptor::listen(const InetAddress &address) {
+Result<Acceptor> Acceptor::listen(const InetAddress &address, bool reuse_port) {
     std::error_code ec;
     Acceptor acceptor;
     acceptor.listener_ = Socket::open(address.is_ipv4() ? Ip::v4 : Ip::v6, Transport::Tcp) | redirect_err(ec);
@@ -31,6 +63,13 @@ Result<Acceptor> Acceptor::listen(const InetAddress &address) {
         return {ec};
     }
 
+    if (reuse_port) {
+        acceptor.listener_.set_reuse_port(true) | redirect_err(ec);
+        if (ec) {
+            return {ec};
+        }
+    }
+
     acceptor.listener_.bind(address) | redirect_err(ec);
     if (ec) {
         return {ec};
@@ -44,35 +83,113 @@ Result<Acceptor> Acceptor::listen(const InetAddress &address) {
     return {std::move(acceptor)};
 }
 
+Result<> Acceptor::steer_by_cpu(unsigned group_size) {
+    return steer_by_cpu(std::vector<std::vector<int>>(group_size));
+}
+
+Result<> Acceptor::steer_by_cpu(const std::vector<std::vector<int>>& cpus) {
+#ifdef __linux__
+    if (cpus.empty()) {
+        return {std::make_error_code(std::errc::invalid_argument)};
+    }
+
+    // A = cpu; if (A == cpu of listener i) return i; ...; A %= group_size; return A
+    std::vector<sock_filter> code{
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0, (uint32_t)(SKF_AD_OFF + SKF_AD_CPU)}
+    };
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        for (int cpu : cpus[i]) {
+            // equal -> the return right after, else skip it
+            code.push_back({BPF_JMP | BPF_JEQ | BPF_K, 0, 1, (uint32_t)cpu});
+            code.push_back({BPF_RET | BPF_K, 0, 0, (uint32_t)i});
+        }
+    }
+    code.push_back({BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)cpus.size()});
+    code.push_back({BPF_RET | BPF_A, 0, 0, 0});
+    if (code.size() > BPF_MAXINSNS) {
+        return {std::make_error_code(std::errc::argument_out_of_domain)};
+    }
+
+    sock_fprog prog{
+        .len = (unsigned short)code.size(),
+        .filter = code.data()
+    };
+
+    if (-1 == ::setsockopt(listener_.handle(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog))) {
+        return {SYSTEM_ERROR_CODE};
+    }
+    return {};
+#else
+    return {std::make_error_code(std::errc::not_supported)};
+#endif
+}
+
 #ifdef MAGIO_USE_CORO
-Coro<Result<std::pair<Socket, InetAddress>>> Acceptor::accept() {
+Coro<Result<std::pair<Socket, InetAddress>>> Acceptor::accept(Deadline deadline) {
     attach_context();
-    struct AcceptResume: ResumeHandle {
-        InetAddress address;
-    } rh;
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().accept(ioc, listener_, ptr, cb, deadline);
+    });
+    auto ec = co_await awaiter;
 
-    co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
-        rh.handle = h;
-        this_context::get_service().accept(listener_, &rh, 
-            [](std::error_code ec, IoContext* ioc, void* ptr) {
-                auto rh = (AcceptResume*)ptr;
-                rh->ec = ec;
-                rh->res = ioc->res;
-                rh->address = InetAddress::from((sockaddr*)&ioc->remote_addr);
-                rh->handle.resume();
+    if (ec) {
+        co_return {ec};
+    }
+    auto& ioc = awaiter.context();
+    co_return {{
+        Socket((SocketHandle)ioc.res, listener_.ip(), listener_.transport()), 
+        InetAddress::from((sockaddr*)&ioc.remote_addr)
+    }};
+}
 
-                delete ioc;
+Coro<Result<std::pair<Socket, InetAddress>>> Acceptor::accept_multishot() {
+    using Receiver = magio::detail::MultishotReceiver<std::pair<Socket, InetAddress>>;
+    attach_context();
+    if (!receiver_) {
+        receiver_ = new Receiver;
+    }
+
+    auto receiver = receiver_;
+    if (receiver->ready.empty() && !receiver->ioc) {
+        // set before the op is submitted, an inline completion clears it
+        receiver->ioc = new IoContext;
+        this_context::get_service().accept_multishot(*receiver->ioc, listener_, receiver,
+            [](std::error_code ec, IoContext* ioc, void* ptr) {
+                auto receiver = (Receiver*)ptr;
+                if (ec) {
+                    receiver->complete(ec, ioc, {});
+                } else {
+                    Ip ip = ioc->remote_addr.sin_family == AF_INET ? Ip::v4 : Ip::v6;
+                    receiver->complete(ec, ioc, {
+                        Socket((SocketHandle)ioc->res, ip, Transport::Tcp), 
+                        InetAddress::from((sockaddr*)&ioc->remote_addr)
+                    });
+                }
             });
-    });
+    }
 
-    if (rh.ec) {
-        co_return {rh.ec};
+    if (receiver->ready.empty()) {
+        co_await GetCoroutineHandle([receiver](std::coroutine_handle<> h) {
+            receiver->waiter = h;
+        });
+    } else if (!magio::detail::consume_coop_budget()) {
+        // ready without suspending, but the budget is spent
+        co_await this_coro::yield;
+    }
+
+    auto [ec, conn] = receiver->pop();
+    if (ec) {
+        co_return {ec};
     }
-    co_return {{Socket((SocketHandle)rh.res, listener_.ip(), listener_.transport()), std::move(rh.address)}};
+    co_return {std::move(conn)};
 }
 #endif
 
 void Acceptor::accept(Functor<void (std::error_code, Socket, InetAddress)> &&completion_cb) {
+    accept(Deadline{}, std::move(completion_cb));
+}
+
+void Acceptor::accept(Deadline deadline, Functor<void (std::error_code, Socket, InetAddress)> &&completion_cb) {
     using Cb = Functor<void (std::error_code, Socket, InetAddress)>;
     attach_context();
 
@@ -90,6 +207,29 @@ void Acceptor::accept(Functor<void (std::error_code, Socket, InetAddress)> &&com
             }
             delete cb;
             delete ioc;
+        }, deadline);
+}
+
+void Acceptor::accept_multishot(Functor<void (std::error_code, Socket, InetAddress)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, Socket, InetAddress)>;
+    attach_context();
+
+    this_context::get_service().accept_multishot(listener_, new Cb(std::move(completion_cb)), 
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto cb = (Cb*)ptr;
+            Ip ip = ioc->remote_addr.sin_family == AF_INET ? Ip::v4 : Ip::v6;
+            if (ec) {
+                (*cb)(ec, {}, {});
+            } else {
+                (*cb)(
+                    ec, Socket((int)ioc->res, ip, Transport::Tcp),
+                    InetAddress::from((sockaddr*)&ioc->remote_addr)
+                );
+            }
+            if (!ioc->more) {
+                delete cb;
+                delete ioc;
+            }
         });
 }
 
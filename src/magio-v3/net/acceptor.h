@@ -1,6 +1,8 @@
 #ifndef MAGIO_NET_ACCEPTOR_H_
 #define MAGIO_NET_ACCEPTOR_H_
 
+#include <vector>
+
 #include "magio-v3/utils/noncopyable.h"
 #include "magio-v3/core/error.h"
 #include "magio-v3/net/socket.h"
@@ -13,24 +15,47 @@ class Acceptor: Noncopyable {
 public:
     Acceptor();
 
+    ~Acceptor();
+
     Acceptor(Acceptor&& other) noexcept;
 
     Acceptor& operator=(Acceptor&& other) noexcept;
 
+    // reuse_port: see Socket::set_reuse_port
     [[nodiscard]]
-    static Result<Acceptor> listen(const InetAddress& address);
+    static Result<Acceptor> listen(const InetAddress& address, bool reuse_port = false);
+
+    // for the SO_REUSEPORT group of this listener, a connection goes to 
+    // the group_size listeners by the cpu that received it: cpu % group_size. 
+    // listeners are numbered in the order they were opened
+    Result<> steer_by_cpu(unsigned group_size);
+
+    // the same with a table, a connection received on one of cpus[i] goes 
+    // to listener i, one on a cpu not in the table to cpu % cpus.size()
+    Result<> steer_by_cpu(const std::vector<std::vector<int>>& cpus);
 
 #ifdef MAGIO_USE_CORO
     [[nodiscard]]
-    Coro<Result<std::pair<Socket, InetAddress>>> accept();
+    Coro<Result<std::pair<Socket, InetAddress>>> accept(Deadline deadline = {});
+
+    // the first call arms a multishot accept, 
+    // every call hands back the next accepted connection
+    [[nodiscard]]
+    Coro<Result<std::pair<Socket, InetAddress>>> accept_multishot();
 #endif
 
     void accept(Functor<void(std::error_code, Socket, InetAddress)>&& completion_cb);
 
+    void accept(Deadline deadline, Functor<void(std::error_code, Socket, InetAddress)>&& completion_cb);
+
+    // completion_cb is invoked once per accepted connection until an error
+    void accept_multishot(Functor<void(std::error_code, Socket, InetAddress)>&& completion_cb);
+
     void attach_context();
 
 private:
     Socket listener_;
+    magio::detail::MultishotReceiver<std::pair<Socket, InetAddress>>* receiver_ = nullptr;
 };
 
 }
@@ -4,75 +4,266 @@
 #include "magio-v3/net/socket.h"
 #include "magio-v3/net/address.h"
 
+#ifdef __linux__
+#include <netinet/udp.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif
+
 namespace magio {
 
+// false -> the deadline can not be kept here, cb got std::errc::not_supported
+static bool set_deadline(IoContext* ioc, Deadline deadline) {
+    if (deadline == Deadline{}) {
+        return true;
+    }
+#ifdef __linux__
+    // steady_clock is CLOCK_MONOTONIC, the clock of io_uring timeouts
+    long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        deadline.time_since_epoch()).count();
+    ioc->deadline = {
+        .tv_sec = ns / 1000000000,
+        .tv_nsec = ns % 1000000000
+    };
+    return true;
+#else
+    // iocp has no linked timeout
+    ioc->cb(std::make_error_code(std::errc::not_supported), ioc, ioc->ptr);
+    return false;
+#endif
+}
+
 void IoService::write_file(IoHandle ioh, const char *msg, size_t len, size_t offset, void *user_ptr, Cb cb) {
-    auto ioc = new IoContext{
+    write_file(*new IoContext, ioh, msg, len, offset, user_ptr, cb);
+}
+
+void IoService::write_file(IoContext& ioc, IoHandle ioh, const char *msg, size_t len, size_t offset, void *user_ptr, Cb cb) {
+    ioc = IoContext{
         .op = Operation::WriteFile,
         .iovec = io_buf((char*)msg, len),
         .ptr = user_ptr,
         .cb = cb
     };
     
-    impl_->write_file(ioh, offset, ioc);
+    impl_->write_file(ioh, offset, &ioc);
 }
 
-void IoService::read_file(IoHandle ioh, char* buf, size_t len, size_t offset, void *user_ptr, Cb cb) {
-    auto ioc = new IoContext{
+void IoService::read_file(IoHandle ioh, char* buf, size_t len, size_t offset, void *user_ptr, Cb cb, Deadline deadline) {
+    read_file(*new IoContext, ioh, buf, len, offset, user_ptr, cb, deadline);
+}
+
+void IoService::read_file(IoContext& ioc, IoHandle ioh, char* buf, size_t len, size_t offset, void *user_ptr, Cb cb, Deadline deadline) {
+    ioc = IoContext{
         .op = Operation::ReadFile,
         .iovec = io_buf(buf, len),
         .ptr = user_ptr,
         .cb = cb
     };
 
-    impl_->read_file(ioh, offset, ioc);
+    if (!set_deadline(&ioc, deadline)) {
+        return;
+    }
+    impl_->read_file(ioh, offset, &ioc);
 }
 
-void IoService::accept(const net::Socket& listener, void *user_ptr, Cb cb) {
-    auto ioc = new IoContext{
+void IoService::writev_file(IoHandle ioh, const IoVec *bufs, size_t n, size_t offset, void *user_ptr, Cb cb) {
+    writev_file(*new IoContext, ioh, bufs, n, offset, user_ptr, cb);
+}
+
+void IoService::writev_file(IoContext& ioc, IoHandle ioh, const IoVec *bufs, size_t n, size_t offset, void *user_ptr, Cb cb) {
+    ioc = IoContext{
+        .op = Operation::WriteFileVectored,
+        .iovec = io_buf((char*)bufs, n),
+        .ptr = user_ptr,
+        .cb = cb
+    };
+
+    impl_->writev_file(ioh, offset, &ioc);
+}
+
+void IoService::readv_file(IoHandle ioh, const IoVec *bufs, size_t n, size_t offset, void *user_ptr, Cb cb) {
+    readv_file(*new IoContext, ioh, bufs, n, offset, user_ptr, cb);
+}
+
+void IoService::readv_file(IoContext& ioc, IoHandle ioh, const IoVec *bufs, size_t n, size_t offset, void *user_ptr, Cb cb) {
+    ioc = IoContext{
+        .op = Operation::ReadFileVectored,
+        .iovec = io_buf((char*)bufs, n),
+        .ptr = user_ptr,
+        .cb = cb
+    };
+
+    impl_->readv_file(ioh, offset, &ioc);
+}
+
+void IoService::accept(const net::Socket& listener, void *user_ptr, Cb cb, Deadline deadline) {
+    accept(*new IoContext, listener, user_ptr, cb, deadline);
+}
+
+void IoService::accept(IoContext& ioc, const net::Socket& listener, void *user_ptr, Cb cb, Deadline deadline) {
+    ioc = IoContext{
         .op = Operation::Accept,
         .ptr = user_ptr,
         .cb = cb
     };
     
-    impl_->accept(listener, ioc);
+    if (!set_deadline(&ioc, deadline)) {
+        return;
+    }
+    impl_->accept(listener, &ioc);
 }
 
-void IoService::connect(SocketHandle socket, const net::InetAddress &remote, void *user_ptr, Cb cb) {
-    auto ioc = new IoContext{
+void IoService::accept_multishot(const net::Socket& listener, void *user_ptr, Cb cb) {
+    accept_multishot(*new IoContext, listener, user_ptr, cb);
+}
+
+void IoService::accept_multishot(IoContext& ioc, const net::Socket& listener, void *user_ptr, Cb cb) {
+    ioc = IoContext{
+        .op = Operation::AcceptMultishot,
+        .ptr = user_ptr,
+        .cb = cb
+    };
+
+    impl_->accept_multishot(listener, &ioc);
+}
+
+void IoService::connect(SocketHandle socket, const net::InetAddress &remote, void *user_ptr, Cb cb, Deadline deadline) {
+    connect(*new IoContext, socket, remote, user_ptr, cb, deadline);
+}
+
+void IoService::connect(IoContext& ioc, SocketHandle socket, const net::InetAddress &remote, void *user_ptr, Cb cb, Deadline deadline) {
+    ioc = IoContext{
         .op = Operation::Connect,
         .addr_len = (socklen_t)remote.sockaddr_len(),
         .ptr = user_ptr,
         .cb = cb
     };
 
-    std::memcpy(&ioc->remote_addr, remote.buf_, ioc->addr_len);
-    impl_->connect(socket, ioc);
+    std::memcpy(&ioc.remote_addr, remote.buf_, ioc.addr_len);
+    if (!set_deadline(&ioc, deadline)) {
+        return;
+    }
+    impl_->connect(socket, &ioc);
 }
 
-void IoService::send(SocketHandle socket, const char *msg, size_t len, void *user_ptr, Cb cb) {
-    auto ioc = new IoContext{
+void IoService::send(SocketHandle socket, const char *msg, size_t len, void *user_ptr, Cb cb, Deadline deadline) {
+    send(*new IoContext, socket, msg, len, user_ptr, cb, deadline);
+}
+
+void IoService::send(IoContext& ioc, SocketHandle socket, const char *msg, size_t len, void *user_ptr, Cb cb, Deadline deadline) {
+    ioc = IoContext{
         .op = Operation::Send,
         .iovec = io_buf((char*)msg, len),
         .ptr = user_ptr,
         .cb = cb
     };
 
-    impl_->send(socket, ioc);
+    if (!set_deadline(&ioc, deadline)) {
+        return;
+    }
+    impl_->send(socket, &ioc);
 }
 
-void IoService::receive(SocketHandle socket, char *buf, size_t len, void *user_ptr, Cb cb) {
-    auto ioc = new IoContext{
-        .op = Operation::Send,
+void IoService::receive(SocketHandle socket, char *buf, size_t len, void *user_ptr, Cb cb, Deadline deadline) {
+    receive(*new IoContext, socket, buf, len, user_ptr, cb, deadline);
+}
+
+void IoService::receive(IoContext& ioc, SocketHandle socket, char *buf, size_t len, void *user_ptr, Cb cb, Deadline deadline) {
+    ioc = IoContext{
+        .op = Operation::Receive,
         .iovec = io_buf(buf, len),
         .ptr = user_ptr,
         .cb = cb
     };
 
-    impl_->receive(socket, ioc);
+    if (!set_deadline(&ioc, deadline)) {
+        return;
+    }
+    impl_->receive(socket, &ioc);
+}
+
+void IoService::send_zc(SocketHandle socket, const char *msg, size_t len, void *user_ptr, Cb cb) {
+    send_zc(*new IoContext, socket, msg, len, user_ptr, cb);
+}
+
+void IoService::send_zc(IoContext& ioc, SocketHandle socket, const char *msg, size_t len, void *user_ptr, Cb cb) {
+    ioc = IoContext{
+        .op = Operation::SendZeroCopy,
+        .iovec = io_buf((char*)msg, len),
+        .ptr = user_ptr,
+        .cb = cb
+    };
+
+    impl_->send_zc(socket, &ioc);
+}
+
+void IoService::sendv(SocketHandle socket, const IoVec *bufs, size_t n, void *user_ptr, Cb cb) {
+    sendv(*new IoContext, socket, bufs, n, user_ptr, cb);
+}
+
+void IoService::sendv(IoContext& ioc, SocketHandle socket, const IoVec *bufs, size_t n, void *user_ptr, Cb cb) {
+    ioc = IoContext{
+        .op = Operation::SendVectored,
+        .iovec = io_buf((char*)bufs, n),
+        .ptr = user_ptr,
+        .cb = cb
+    };
+
+#ifdef __linux__
+    auto info = msghdr{
+        .msg_name = nullptr,
+        .msg_namelen = 0,
+        .msg_iov = (iovec*)bufs,
+        .msg_iovlen = n,
+        .msg_control = nullptr,
+        .msg_controllen = 0,
+        .msg_flags = 0
+    };
+
+    ioc.ptr = new ResumeWithMsg{
+        .msg = {info},
+        .ptr = user_ptr
+    };
+#endif
+
+    impl_->sendv(socket, &ioc);
+}
+
+void IoService::receivev(SocketHandle socket, const IoVec *bufs, size_t n, void *user_ptr, Cb cb) {
+    receivev(*new IoContext, socket, bufs, n, user_ptr, cb);
+}
+
+void IoService::receivev(IoContext& ioc, SocketHandle socket, const IoVec *bufs, size_t n, void *user_ptr, Cb cb) {
+    ioc = IoContext{
+        .op = Operation::ReceiveVectored,
+        .iovec = io_buf((char*)bufs, n),
+        .ptr = user_ptr,
+        .cb = cb
+    };
+
+#ifdef __linux__
+    auto info = msghdr{
+        .msg_name = nullptr,
+        .msg_namelen = 0,
+        .msg_iov = (iovec*)bufs,
+        .msg_iovlen = n,
+        .msg_control = nullptr,
+        .msg_controllen = 0,
+        .msg_flags = 0
+    };
+
+    ioc.ptr = new ResumeWithMsg{
+        .msg = {info},
+        .ptr = user_ptr
+    };
+#endif
+
+    impl_->receivev(socket, &ioc);
 }
 
-void IoService::send_to(SocketHandle socket, const net::InetAddress &remote, const char *msg, size_t len, void *user_ptr, Cb cb) {
+void IoService::send_to(SocketHandle socket, const net::InetAddress &remote, const char *msg, size_t len, void *user_ptr, Cb cb, size_t segment_size) {
     auto ioc = new IoContext{
         .op = Operation::SendTo,
         .iovec = io_buf((char*)msg, len),
@@ -93,10 +284,26 @@ void IoService::send_to(SocketHandle socket, const net::InetAddress &remote, con
         .msg_flags = 0
     };
 
-    ioc->ptr = new ResumeWithMsg{
+    auto rwm = new ResumeWithMsg{
         .msg = {info},
         .ptr = user_ptr
     };
+    if (segment_size) {
+        rwm->msg.msg_control = rwm->control;
+        rwm->msg.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&rwm->msg);
+        cmsg->cmsg_level = IPPROTO_UDP;
+        cmsg->cmsg_type = UDP_SEGMENT;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+        uint16_t size = (uint16_t)segment_size;
+        std::memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+    }
+    ioc->ptr = rwm;
+#else
+    if (segment_size) {
+        ioc->cb(std::make_error_code(std::errc::not_supported), ioc, user_ptr);
+        return;
+    }
 #endif
 
     impl_->send_to(socket, ioc);
@@ -122,23 +329,62 @@ void IoService::receive_from(SocketHandle socket, char *buf, size_t len, void *u
         .msg_flags = 0
     };
 
-    ioc->ptr = new ResumeWithMsg{
+    auto rwm = new ResumeWithMsg{
         .msg = {info},
         .ptr = user_ptr
     };
+    rwm->msg.msg_control = rwm->control;
+    rwm->msg.msg_controllen = sizeof(rwm->control);
+    ioc->ptr = rwm;
 #endif
 
     impl_->receive_from(socket, ioc);
 }
 
+void IoService::receive_buffer(SocketHandle socket, void* user_ptr, Cb cb) {
+    receive_buffer(*new IoContext, socket, user_ptr, cb);
+}
+
+void IoService::receive_buffer(IoContext& ioc, SocketHandle socket, void* user_ptr, Cb cb) {
+    ioc = IoContext{
+        .op = Operation::ReceiveBuffer,
+        .ptr = user_ptr,
+        .cb = cb
+    };
+
+    impl_->receive_buffer(socket, &ioc);
+}
+
+void IoService::release_buffer(uint32_t buf_id) {
+    impl_->release_buffer(buf_id);
+}
+
 void IoService::cancel(IoHandle ioh) {
     impl_->cancel(ioh);
 }
 
+void IoService::cancel(IoContext* ioc) {
+    impl_->cancel(ioc);
+}
+
 void IoService::attach(IoHandle ioh, std::error_code &ec) {
     impl_->attach(ioh, ec);
 }
 
+void IoService::detach(IoHandle ioh) {
+    impl_->detach(ioh);
+}
+
+void IoService::send_message(IoService target, void *user_ptr, Cb cb) {
+    auto ioc = new IoContext{
+        .op = Operation::Message,
+        .ptr = user_ptr,
+        .cb = cb
+    };
+
+    impl_->send_message(target.impl_, ioc);
+}
+
 int IoService::poll(size_t nanosec, std::error_code &ec) {
     return impl_->poll(nanosec, ec);
 }
@@ -147,4 +393,52 @@ void IoService::wake_up() {
     impl_->wake_up();
 }
 
+ProvidedBuffer::ProvidedBuffer(IoService service, char* data, size_t len, uint32_t id)
+    : service_(service)
+    , data_(data)
+    , len_(len)
+    , id_(id)
+{ }
+
+ProvidedBuffer::~ProvidedBuffer() {
+    release();
+}
+
+ProvidedBuffer::ProvidedBuffer(ProvidedBuffer&& other) noexcept
+    : service_(other.service_)
+    , data_(other.data_)
+    , len_(other.len_)
+    , id_(other.id_)
+{
+    other.reset();
+}
+
+ProvidedBuffer& ProvidedBuffer::operator=(ProvidedBuffer&& other) noexcept {
+    if (data_ == other.data_) { // self
+        return *this;
+    }
+
+    release();
+    service_ = other.service_;
+    data_ = other.data_;
+    len_ = other.len_;
+    id_ = other.id_;
+    other.reset();
+    return *this;
+}
+
+void ProvidedBuffer::release() {
+    if (data_) {
+        service_.release_buffer(id_);
+        reset();
+    }
+}
+
+void ProvidedBuffer::reset() {
+    service_ = IoService{nullptr};
+    data_ = nullptr;
+    len_ = 0;
+    id_ = 0;
+}
+
 }
\ No newline at end of file
@@ -7,7 +7,10 @@
 #include "magio-v3/net/socket.h"
 
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/eventfd.h>
+#include <netinet/udp.h>
+#include <time.h>
 
 #include "liburing.h"
 
@@ -15,14 +18,95 @@ namespace magio {
 
 namespace net {
 
-IoUring::IoUring(unsigned entries) {
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+constexpr int kBufferGroupId = 0;
+
+static_assert(sizeof(IoVec) == sizeof(iovec) 
+    && offsetof(IoVec, buf) == offsetof(iovec, iov_base) 
+    && offsetof(IoVec, len) == offsetof(iovec, iov_len));
+
+static uint16_t gro_segment_size(msghdr* msg) {
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (IPPROTO_UDP == cmsg->cmsg_level && UDP_GRO == cmsg->cmsg_type) {
+            int size;
+            std::memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+            return (uint16_t)size;
+        }
+    }
+    return 0;
+}
+
+static bool has_deadline(IoContext* ioc) {
+    return ioc->deadline.tv_sec != 0 || ioc->deadline.tv_nsec != 0;
+}
+
+static bool deadline_expired(IoContext* ioc) {
+    timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > ioc->deadline.tv_sec 
+        || (now.tv_sec == ioc->deadline.tv_sec && now.tv_nsec >= ioc->deadline.tv_nsec);
+}
+
+IoUring::IoUring(const CoroContextOptions& options) 
+    : submit_threshold_(options.submit_threshold)
+    , buf_ring_entries_(options.buffer_ring_entries)
+    , buf_size_(options.buffer_ring_buffer_size)
+{
+    if (0 == submit_threshold_) {
+        submit_threshold_ = options.entries / 2 ? options.entries / 2 : 1;
+    }
+
+    if (0 == buf_ring_entries_ || (buf_ring_entries_ & (buf_ring_entries_ - 1)) 
+        || buf_ring_entries_ > 32768) 
+    {
+        M_FATAL("{}", "Buffer ring entries must be a power of 2 and <= 32768");
+    }
+
     io_uring_params params;
     std::memset(&params, 0, sizeof(params));
+    if (options.sq_poll) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = options.sq_thread_idle;
+        if (options.sq_thread_cpu >= 0) {
+            params.flags |= IORING_SETUP_SQ_AFF;
+            params.sq_thread_cpu = options.sq_thread_cpu;
+        }
+    }
+    if (options.single_issuer) {
+        params.flags |= IORING_SETUP_SINGLE_ISSUER;
+    }
+    if (options.defer_taskrun) {
+        params.flags |= IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+    }
+    if (options.coop_taskrun) {
+        params.flags |= IORING_SETUP_COOP_TASKRUN;
+    }
 
     p_io_uring_ = new io_uring;
-    if (0 > ::io_uring_queue_init_params(entries, p_io_uring_, &params)) {
+    int r = ::io_uring_queue_init_params(options.entries, p_io_uring_, &params);
+    if (-EINVAL == r && params.flags) {
+        // older kernels reject the flags they do not know, they are only optimizations
+        M_WARN("io uring setup flags {:#x} are not supported, fall back to none", params.flags);
+        std::memset(&params, 0, sizeof(params));
+        r = ::io_uring_queue_init_params(options.entries, p_io_uring_, &params);
+    }
+    if (0 > r) {
         delete p_io_uring_;
-        M_FATAL("failed to create io uring: {}", SYSTEM_ERROR_CODE.message());
+        M_FATAL("failed to create io uring: {}", make_system_error_code(-r).message());
+    }
+
+    if (options.fixed_files > 0) {
+        r = ::io_uring_register_files_sparse(p_io_uring_, options.fixed_files);
+        if (r < 0) {
+            M_WARN("failed to register the fixed file table: {}", make_system_error_code(-r).message());
+        } else {
+            for (int slot = options.fixed_files - 1; slot >= 0; --slot) {
+                free_slots_.push_back(slot);
+            }
+        }
     }
 
     wake_up_fd_ = ::eventfd(EFD_NONBLOCK, 0);
@@ -49,6 +133,11 @@ IoUring::IoUring(unsigned entries) {
 IoUring::~IoUring() {
     if (p_io_uring_) {
         ::close(wake_up_fd_);
+        if (buf_ring_) {
+            ::io_uring_unregister_buf_ring(p_io_uring_, kBufferGroupId);
+            ::munmap(buf_ring_, buf_ring_entries_ * sizeof(io_uring_buf));
+            delete[] buf_base_;
+        }
         ::io_uring_queue_exit(p_io_uring_);
         delete wake_up_ctx_;
         delete empty_ctx_;
@@ -58,85 +147,240 @@ IoUring::~IoUring() {
 
 void IoUring::write_file(IoHandle ioh, size_t offset, IoContext *ioc) {
     ++io_num_;
-    io_uring_sqe* sqe = ::io_uring_get_sqe(p_io_uring_);
+    io_uring_sqe* sqe = get_sqe(has_deadline(ioc) ? 2 : 1);
     ::io_uring_prep_write(sqe, ioh.a, ioc->iovec.buf, ioc->iovec.len, offset);
+    use_fixed_file(sqe);
     ::io_uring_sqe_set_data(sqe, ioc);
+    link_deadline(sqe, ioc);
 }
 
 void IoUring::read_file(IoHandle ioh, size_t offset, IoContext *ioc){
     ++io_num_;
-    io_uring_sqe* sqe = ::io_uring_get_sqe(p_io_uring_);
+    io_uring_sqe* sqe = get_sqe(has_deadline(ioc) ? 2 : 1);
     ::io_uring_prep_read(sqe, ioh.a, ioc->iovec.buf, ioc->iovec.len, offset);
+    use_fixed_file(sqe);
+    ::io_uring_sqe_set_data(sqe, ioc);
+    link_deadline(sqe, ioc);
+}
+
+void IoUring::writev_file(IoHandle ioh, size_t offset, IoContext *ioc) {
+    ++io_num_;
+    io_uring_sqe* sqe = get_sqe();
+    ::io_uring_prep_writev(sqe, ioh.a, (const iovec*)ioc->iovec.buf, ioc->iovec.len, offset);
+    use_fixed_file(sqe);
+    ::io_uring_sqe_set_data(sqe, ioc);
+}
+
+void IoUring::readv_file(IoHandle ioh, size_t offset, IoContext *ioc) {
+    ++io_num_;
+    io_uring_sqe* sqe = get_sqe();
+    ::io_uring_prep_readv(sqe, ioh.a, (const iovec*)ioc->iovec.buf, ioc->iovec.len, offset);
+    use_fixed_file(sqe);
     ::io_uring_sqe_set_data(sqe, ioc);
 }
 
 void IoUring::accept(const net::Socket &listener, IoContext *ioc) {
     ++io_num_;
-    io_uring_sqe* sqe = ::io_uring_get_sqe(p_io_uring_);
+    io_uring_sqe* sqe = get_sqe(has_deadline(ioc) ? 2 : 1);
     ::io_uring_prep_accept(
         sqe, listener.handle(), (sockaddr*)&ioc->remote_addr, 
         &ioc->addr_len, 0
     );
+    use_fixed_file(sqe);
+    ::io_uring_sqe_set_data(sqe, ioc);
+    link_deadline(sqe, ioc);
+}
+
+void IoUring::accept_multishot(const net::Socket &listener, IoContext *ioc) {
+    ++io_num_;
+    io_uring_sqe* sqe = get_sqe();
+    // every completion would share one sockaddr, so the peer is queried per socket
+    ::io_uring_prep_multishot_accept(sqe, listener.handle(), nullptr, nullptr, 0);
+    use_fixed_file(sqe);
     ::io_uring_sqe_set_data(sqe, ioc);
 }
 
 void IoUring::connect(SocketHandle socket, IoContext *ioc) {
     ++io_num_;
-    io_uring_sqe* sqe = ::io_uring_get_sqe(p_io_uring_);
+    io_uring_sqe* sqe = get_sqe(has_deadline(ioc) ? 2 : 1);
     ::io_uring_prep_connect(
         sqe, socket, (sockaddr*)&ioc->remote_addr, ioc->addr_len
     );
+    use_fixed_file(sqe);
     ::io_uring_sqe_set_data(sqe, ioc);
+    link_deadline(sqe, ioc);
 }
 
 void IoUring::send(SocketHandle socket, IoContext *ioc) {
     ++io_num_;
-    io_uring_sqe* sqe = ::io_uring_get_sqe(p_io_uring_);
+    io_uring_sqe* sqe = get_sqe(has_deadline(ioc) ? 2 : 1);
     ::io_uring_prep_send(sqe, socket, ioc->iovec.buf, ioc->iovec.len, 0);
+    use_fixed_file(sqe);
     ::io_uring_sqe_set_data(sqe, ioc);
+    link_deadline(sqe, ioc);
 }
 
 void IoUring::receive(SocketHandle socket, IoContext *ioc) {
     ++io_num_;
-    io_uring_sqe* sqe = ::io_uring_get_sqe(p_io_uring_);
+    io_uring_sqe* sqe = get_sqe(has_deadline(ioc) ? 2 : 1);
     ::io_uring_prep_recv(sqe, socket, ioc->iovec.buf, ioc->iovec.len, 0);
+    use_fixed_file(sqe);
+    ::io_uring_sqe_set_data(sqe, ioc);
+    link_deadline(sqe, ioc);
+}
+
+void IoUring::send_zc(SocketHandle socket, IoContext *ioc) {
+    ++io_num_;
+    io_uring_sqe* sqe = get_sqe(has_deadline(ioc) ? 2 : 1);
+    ::io_uring_prep_send_zc(sqe, socket, ioc->iovec.buf, ioc->iovec.len, 0, 0);
+    use_fixed_file(sqe);
+    ::io_uring_sqe_set_data(sqe, ioc);
+    link_deadline(sqe, ioc);
+}
+
+void IoUring::sendv(SocketHandle socket, IoContext *ioc) {
+    ++io_num_;
+    io_uring_sqe* sqe = get_sqe();
+    auto rwm = (ResumeWithMsg*)ioc->ptr;
+    ::io_uring_prep_sendmsg(sqe, socket, &rwm->msg, 0);
+    use_fixed_file(sqe);
+    ::io_uring_sqe_set_data(sqe, ioc);
+}
+
+void IoUring::receivev(SocketHandle socket, IoContext *ioc) {
+    ++io_num_;
+    io_uring_sqe* sqe = get_sqe();
+    auto rwm = (ResumeWithMsg*)ioc->ptr;
+    ::io_uring_prep_recvmsg(sqe, socket, &rwm->msg, 0);
+    use_fixed_file(sqe);
     ::io_uring_sqe_set_data(sqe, ioc);
 }
 
 void IoUring::send_to(SocketHandle socket, IoContext *ioc) {
     ++io_num_;
-    io_uring_sqe* sqe = ::io_uring_get_sqe(p_io_uring_);
+    io_uring_sqe* sqe = get_sqe(has_deadline(ioc) ? 2 : 1);
     auto rwm = (ResumeWithMsg*)ioc->ptr;
     ::io_uring_prep_sendmsg(sqe, socket, &rwm->msg, 0);
+    use_fixed_file(sqe);
     ::io_uring_sqe_set_data(sqe, ioc);
+    link_deadline(sqe, ioc);
 }
 
 void IoUring::receive_from(SocketHandle socket, IoContext *ioc) {
     ++io_num_;
-    io_uring_sqe* sqe = ::io_uring_get_sqe(p_io_uring_);
+    io_uring_sqe* sqe = get_sqe(has_deadline(ioc) ? 2 : 1);
     auto rwm = (ResumeWithMsg*)ioc->ptr;
-    printf("recv fd %d\n", socket);
     ::io_uring_prep_recvmsg(sqe, socket, &rwm->msg, 0);
+    use_fixed_file(sqe);
     ::io_uring_sqe_set_data(sqe, ioc);
+    link_deadline(sqe, ioc);
+}
+
+void IoUring::receive_buffer(SocketHandle socket, IoContext *ioc) {
+    std::error_code ec;
+    if (!buf_ring_ && !setup_buffer_ring(ec)) {
+        ioc->res = 0;
+        ioc->more = false;
+        ioc->cb(ec, ioc, ioc->ptr);
+        return;
+    }
+
+    buffer_receives_.emplace(ioc, socket);
+    prep_receive_buffer(socket, ioc);
+}
+
+void IoUring::prep_receive_buffer(SocketHandle socket, IoContext* ioc) {
+    ++io_num_;
+    io_uring_sqe* sqe = get_sqe();
+    ::io_uring_prep_recv_multishot(sqe, socket, nullptr, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kBufferGroupId;
+    use_fixed_file(sqe);
+    ::io_uring_sqe_set_data(sqe, ioc);
+}
+
+void IoUring::release_buffer(uint32_t buf_id) {
+    ::io_uring_buf_ring_add(
+        buf_ring_, buf_base_ + buf_id * buf_size_, buf_size_, 
+        buf_id, ::io_uring_buf_ring_mask(buf_ring_entries_), 0
+    );
+    ::io_uring_buf_ring_advance(buf_ring_, 1);
+
+    // the receives the dry ring ended get their turn again
+    if (!starved_.empty()) {
+        auto starved = std::move(starved_);
+        starved_.clear();
+        for (auto ioc : starved) {
+            prep_receive_buffer(buffer_receives_[ioc], ioc);
+        }
+    }
+}
+
+void IoUring::cancel_starved(size_t i) {
+    IoContext* ioc = starved_[i];
+    starved_.erase(starved_.begin() + i);
+    buffer_receives_.erase(ioc);
+    ioc->res = 0;
+    ioc->more = false;
+    ioc->iovec = io_buf(nullptr, 0);
+    ioc->cb(make_system_error_code(ECANCELED), ioc, ioc->ptr);
 }
 
 void IoUring::cancel(IoHandle ioh) {
-    io_uring_sqe* sqe = ::io_uring_get_sqe(p_io_uring_);
+    // parked ones are not in the kernel, nothing there would cancel them
+    for (size_t i = starved_.size(); i-- > 0; ) {
+        if (buffer_receives_[starved_[i]] == ioh.a) {
+            cancel_starved(i);
+        }
+    }
+
+    io_uring_sqe* sqe = get_sqe();
     ::io_uring_prep_cancel_fd(sqe, ioh.a, 0);
     ::io_uring_sqe_set_data(sqe, empty_ctx_);
 }
 
+void IoUring::cancel(IoContext *ioc) {
+    for (size_t i = 0; i < starved_.size(); ++i) {
+        if (starved_[i] == ioc) {
+            cancel_starved(i);
+            return;
+        }
+    }
+
+    io_uring_sqe* sqe = get_sqe();
+    ::io_uring_prep_cancel(sqe, ioc, 0);
+    ::io_uring_sqe_set_data(sqe, empty_ctx_);
+}
+
+void IoUring::send_message(IoServiceInterface* target, IoContext *ioc) {
+    io_uring_sqe* sqe = get_sqe();
+    ::io_uring_prep_msg_ring(
+        sqe, static_cast<IoUring*>(target)->p_io_uring_->ring_fd, 0, (uint64_t)ioc, 0
+    );
+    // the target owns ioc once delivered, only a failure posts a cqe here
+    sqe->flags |= IOSQE_CQE_SKIP_SUCCESS;
+    ::io_uring_sqe_set_data(sqe, ioc);
+}
+
 // invoke all completion
 int IoUring::poll(size_t nanosec, std::error_code &ec) {
-    if (nanosec == 0 && io_num_ == 0) {
+    // nothing to submit and completions show up without entering the kernel,
+    // so a non blocking poll, e.g. a busy poll of the context, only peeks.
+    // io_num_ does not count the messages other rings post here, 
+    // so the completion queue is checked even without own ops
+    if (nanosec == 0 && 0 == ::io_uring_sq_ready(p_io_uring_) && backlog_head_ == backlog_.size()
+        && !(p_io_uring_->flags & (IORING_SETUP_COOP_TASKRUN | IORING_SETUP_DEFER_TASKRUN))
+        && 0 == ::io_uring_cq_ready(p_io_uring_)) 
+    {
         return 0;
     }
+
     __kernel_timespec ts{
         .tv_sec = (long long)(nanosec / 1000000000),
         .tv_nsec = (long long)(nanosec % 1000000000)
     };
     io_uring_cqe* cqe = nullptr;
-    // ::io_uring_submit(p_io_uring_);
+    flush_backlog();
 
     int r = ::io_uring_submit_and_wait_timeout(p_io_uring_, &cqe, 1, &ts, nullptr);
     if (-ETIME == r || -EAGAIN == r) {
@@ -152,29 +396,149 @@ int IoUring::poll(size_t nanosec, std::error_code &ec) {
     io_uring_for_each_cqe(p_io_uring_, head, cqe) {
         ++count;
         handle_cqe(cqe);
+        run_completion_hook();
     }
     ::io_uring_cq_advance(p_io_uring_, count);
     
     return 1;
 }
 
+io_uring_sqe* IoUring::get_sqe(unsigned chain) {
+    if (chain_left_ == 0) {
+        chain_left_ = chain;
+        to_backlog_ = backlog_head_ != backlog_.size();
+        if (!to_backlog_) {
+            if (::io_uring_sq_ready(p_io_uring_) >= submit_threshold_ 
+                || ::io_uring_sq_space_left(p_io_uring_) < chain) 
+            {
+                ::io_uring_submit(p_io_uring_);
+            }
+            // the kernel has not consumed the ring yet (sqpoll, busy cq)
+            to_backlog_ = ::io_uring_sq_space_left(p_io_uring_) < chain;
+        }
+
+        if (to_backlog_ && backlog_.capacity() < backlog_.size() + chain) {
+            backlog_.reserve(2 * (backlog_.size() + chain));
+        }
+    }
+
+    --chain_left_;
+    if (to_backlog_) {
+        return &backlog_.emplace_back();
+    }
+    return ::io_uring_get_sqe(p_io_uring_);
+}
+
+void IoUring::flush_backlog() {
+    while (backlog_head_ < backlog_.size()) {
+        // a linked chain is moved as a whole
+        size_t len = 1;
+        while (backlog_head_ + len < backlog_.size() 
+            && backlog_[backlog_head_ + len - 1].flags & IOSQE_IO_LINK) 
+        {
+            ++len;
+        }
+
+        if (::io_uring_sq_space_left(p_io_uring_) < len) {
+            ::io_uring_submit(p_io_uring_);
+            if (::io_uring_sq_space_left(p_io_uring_) < len) {
+                break;
+            }
+        }
+
+        for (size_t i = 0; i < len; ++i) {
+            *::io_uring_get_sqe(p_io_uring_) = backlog_[backlog_head_++];
+        }
+    }
+
+    if (backlog_head_ == backlog_.size()) {
+        backlog_.clear();
+        backlog_head_ = 0;
+    }
+}
+
+void IoUring::link_deadline(io_uring_sqe* sqe, IoContext* ioc) {
+    if (!has_deadline(ioc)) {
+        return;
+    }
+
+    // the kernel cancels the op when the timeout fires first
+    sqe->flags |= IOSQE_IO_LINK;
+    io_uring_sqe* timeout_sqe = get_sqe();
+    ::io_uring_prep_link_timeout(timeout_sqe, &ioc->deadline, IORING_TIMEOUT_ABS);
+    ::io_uring_sqe_set_data(timeout_sqe, empty_ctx_);
+}
+
 void IoUring::handle_cqe(io_uring_cqe* cqe) {
     std::error_code inner_ec;
     IoContext* ioc = (IoContext*)::io_uring_cqe_get_data(cqe);
+    int res = cqe->res;
+
+    if (ioc->op == Operation::SendZeroCopy) {
+        if (cqe->flags & IORING_CQE_F_MORE) {
+            // the result comes first, the buffer is released by a later notification
+            ioc->res = (uint64_t)(int64_t)res;
+            return;
+        }
+        if (cqe->flags & IORING_CQE_F_NOTIF) {
+            res = (int)(int64_t)ioc->res;
+        }
+    }
+
+    if (-ECANCELED == res && has_deadline(ioc) && deadline_expired(ioc)) {
+        res = -ETIMEDOUT;
+    }
 
-    if (ioc->op != Operation::Noop) {
+    ioc->more = cqe->flags & IORING_CQE_F_MORE;
+    if (ioc->op != Operation::Noop && ioc->op != Operation::Message && !ioc->more) {
         --io_num_;
     }
 
-    if (cqe->res < 0) {
-        inner_ec = make_system_error_code(-cqe->res);
+    if (ioc->op == Operation::ReceiveBuffer && !ioc->more) {
+        // the shared ring ran dry while its buffers are held, not an error
+        // of this socket. parked until a buffer is released
+        if (-ENOBUFS == res) {
+            starved_.push_back(ioc);
+            return;
+        }
+        buffer_receives_.erase(ioc);
+    }
+
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        ioc->buf_id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        ioc->iovec = io_buf(
+            buf_base_ + ioc->buf_id * buf_size_, 
+            res < 0 ? 0 : res
+        );
+    } else if (ioc->op == Operation::ReceiveBuffer) {
+        ioc->iovec = io_buf(nullptr, 0);
+    }
+
+    if (ioc->op == Operation::SendTo || ioc->op == Operation::ReceiveFrom
+        || ioc->op == Operation::SendVectored || ioc->op == Operation::ReceiveVectored) 
+    {
+        // the msghdr wrapper is freed on errors too
+        auto rwm = (ResumeWithMsg*)ioc->ptr;
+        ioc->addr_len = rwm->msg.msg_namelen;
+        if (ioc->op == Operation::ReceiveFrom && res > 0) {
+            ioc->segment_size = gro_segment_size(&rwm->msg);
+        }
+        ioc->ptr = rwm->ptr;
+        delete rwm;
+    }
+
+    if (res < 0) {
+        inner_ec = make_system_error_code(-res);
         ioc->res = 0;
     } else {
-        ioc->res = cqe->res;
+        ioc->res = res;
         switch (ioc->op) {
         case Operation::WriteFile:
         case Operation::ReadFile:
             break;
+        case Operation::AcceptMultishot:
+            ioc->addr_len = sizeof(sockaddr_in6);
+            [[fallthrough]];
         case Operation::Accept: {
             ::getpeername((int)ioc->res, (sockaddr*)&ioc->remote_addr, &ioc->addr_len);
         }
@@ -182,14 +546,14 @@ void IoUring::handle_cqe(io_uring_cqe* cqe) {
         case Operation::Connect:
         case Operation::Send:
         case Operation::Receive:
-            break;
+        case Operation::ReceiveBuffer:
+        case Operation::SendZeroCopy:
         case Operation::SendTo:
-        case Operation::ReceiveFrom: {
-            auto rwm = (ResumeWithMsg*)ioc->ptr;
-            ioc->addr_len = rwm->msg.msg_namelen;
-            ioc->ptr = rwm->ptr;
-            delete rwm;
-        }
+        case Operation::ReceiveFrom:
+        case Operation::WriteFileVectored:
+        case Operation::ReadFileVectored:
+        case Operation::SendVectored:
+        case Operation::ReceiveVectored:
             break;
         default:
             break;
@@ -204,14 +568,97 @@ void IoUring::wake_up() {
     ::write(wake_up_fd_, &data, sizeof(uint64_t));
 }
 
+size_t IoUring::inflight() const {
+    return io_num_;
+}
+
 void IoUring::prep_wake_up() {
-    io_uring_sqe* sqe = ::io_uring_get_sqe(p_io_uring_);
+    io_uring_sqe* sqe = get_sqe();
     ::io_uring_prep_read(sqe, wake_up_fd_, &wake_up_ctx_->res, sizeof(uint64_t), 0);
     ::io_uring_sqe_set_data(sqe, wake_up_ctx_);
 }
 
+bool IoUring::setup_buffer_ring(std::error_code &ec) {
+    size_t ring_size = buf_ring_entries_ * sizeof(io_uring_buf);
+    void* ring = ::mmap(
+        nullptr, ring_size, PROT_READ | PROT_WRITE, 
+        MAP_ANONYMOUS | MAP_PRIVATE, -1, 0
+    );
+    if (MAP_FAILED == ring) {
+        ec = SYSTEM_ERROR_CODE;
+        return false;
+    }
+
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long)ring;
+    reg.ring_entries = buf_ring_entries_;
+    reg.bgid = kBufferGroupId;
+
+    int r = ::io_uring_register_buf_ring(p_io_uring_, &reg, 0);
+    if (r < 0) {
+        ::munmap(ring, ring_size);
+        ec = make_system_error_code(-r);
+        return false;
+    }
+
+    buf_ring_ = (io_uring_buf_ring*)ring;
+    buf_base_ = new char[buf_ring_entries_ * buf_size_];
+    int mask = ::io_uring_buf_ring_mask(buf_ring_entries_);
+    for (unsigned i = 0; i < buf_ring_entries_; ++i) {
+        ::io_uring_buf_ring_add(
+            buf_ring_, buf_base_ + i * buf_size_, 
+            buf_size_, i, mask, i
+        );
+    }
+    ::io_uring_buf_ring_advance(buf_ring_, buf_ring_entries_);
+    return true;
+}
+
+void IoUring::use_fixed_file(io_uring_sqe* sqe) {
+    if (sqe->fd >= 0 && (size_t)sqe->fd < fixed_slots_.size() && fixed_slots_[sqe->fd] >= 0) {
+        sqe->fd = fixed_slots_[sqe->fd];
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
+}
+
 void IoUring::attach(IoHandle ioh, std::error_code &ec) {
-    return;
+    if (free_slots_.empty() || ioh.a < 0) {
+        return;
+    }
+
+    if ((size_t)ioh.a >= fixed_slots_.size()) {
+        fixed_slots_.resize(ioh.a + 1, -1);
+    } else if (fixed_slots_[ioh.a] >= 0) {
+        return;
+    }
+
+    int slot = free_slots_.back();
+    int r = ::io_uring_register_files_update(p_io_uring_, slot, &ioh.a, 1);
+    if (r < 0) {
+        // keeps using the raw fd
+        ec = make_system_error_code(-r);
+        return;
+    }
+    free_slots_.pop_back();
+    fixed_slots_[ioh.a] = slot;
+}
+
+void IoUring::detach(IoHandle ioh) {
+    if (ioh.a < 0 || (size_t)ioh.a >= fixed_slots_.size() || fixed_slots_[ioh.a] < 0) {
+        return;
+    }
+
+    int slot = fixed_slots_[ioh.a];
+    int fd = -1;
+    fixed_slots_[ioh.a] = -1;
+    int r = ::io_uring_register_files_update(p_io_uring_, slot, &fd, 1);
+    if (r < 0) {
+        // the slot still holds the file, it is not handed out again
+        M_WARN("failed to clear the fixed file slot {}: {}", slot, make_system_error_code(-r).message());
+        return;
+    }
+    free_slots_.push_back(slot);
 }
 
 }
@@ -1,20 +1,28 @@
 #ifndef MAGIO_NET_IO_URING_H_
 #define MAGIO_NET_IO_URING_H_
 
+#include <vector>
+#include <unordered_map>
+
 #include "magio-v3/utils/noncopyable.h"
+#include "magio-v3/core/options.h"
 #include "magio-v3/core/io_service.h"
 
 struct io_uring;
 
+struct io_uring_sqe;
+
 struct io_uring_cqe;
 
+struct io_uring_buf_ring;
+
 namespace magio {
 
 namespace net {
 
 class IoUring: Noncopyable, public IoServiceInterface {
 public:
-    IoUring(unsigned entries);
+    IoUring(const CoroContextOptions& options);
 
     ~IoUring();
     
@@ -22,7 +30,13 @@ public:
 
     void read_file(IoHandle ioh, size_t offset, IoContext* ioc) override;
 
+    void writev_file(IoHandle ioh, size_t offset, IoContext* ioc) override;
+
+    void readv_file(IoHandle ioh, size_t offset, IoContext* ioc) override;
+
     void accept(const net::Socket& listener, IoContext* ioc) override;
+
+    void accept_multishot(const net::Socket& listener, IoContext* ioc) override;
     
     void connect(SocketHandle socket, IoContext* ioc) override;
 
@@ -30,28 +44,85 @@ public:
 
     void receive(SocketHandle socket, IoContext* ioc) override;
 
+    void send_zc(SocketHandle socket, IoContext* ioc) override;
+
+    void sendv(SocketHandle socket, IoContext* ioc) override;
+
+    void receivev(SocketHandle socket, IoContext* ioc) override;
+
     void send_to(SocketHandle socket, IoContext* ioc) override;
 
     void receive_from(SocketHandle socket, IoContext* ioc) override;
 
+    void receive_buffer(SocketHandle socket, IoContext* ioc) override;
+
+    void release_buffer(uint32_t buf_id) override;
+
     void cancel(IoHandle ioh) override;
+
+    void cancel(IoContext* ioc) override;
     
     void attach(IoHandle ioh, std::error_code& ec) override;
 
+    void detach(IoHandle ioh) override;
+
+    void send_message(IoServiceInterface* target, IoContext* ioc) override;
+
     int poll(size_t nanosec, std::error_code& ec) override;
 
     void wake_up() override;
 
+    size_t inflight() const override;
+
 private:
+    // returns a slot of the ring or of the backlog, never nullptr.
+    // chain: the number of sqes the caller takes in a row (linked ops), 
+    // they are kept in the same place
+    io_uring_sqe* get_sqe(unsigned chain = 1);
+
+    void flush_backlog();
+
+    // submits with IOSQE_FIXED_FILE if the fd is registered
+    void use_fixed_file(io_uring_sqe* sqe);
+
+    // appends a linked timeout to sqe if ioc has a deadline, 
+    // sqe must come from get_sqe(2) then
+    void link_deadline(io_uring_sqe* sqe, IoContext* ioc);
+
     void handle_cqe(io_uring_cqe*);
 
     void prep_wake_up();
 
+    bool setup_buffer_ring(std::error_code& ec);
+
+    void prep_receive_buffer(SocketHandle socket, IoContext* ioc);
+
+    // completes a parked buffer receive with ECANCELED
+    void cancel_starved(size_t i);
+
     int wake_up_fd_;
     IoContext* wake_up_ctx_;
     IoContext* empty_ctx_;
     size_t io_num_ = 0;
+    unsigned submit_threshold_;
     io_uring* p_io_uring_ = nullptr;
+    // sqes prepared while the ring was full, drained in order
+    std::vector<io_uring_sqe> backlog_;
+    size_t backlog_head_ = 0;
+    // fd -> slot of the fixed file table, -1 if not registered
+    std::vector<int> fixed_slots_;
+    std::vector<int> free_slots_;
+    unsigned chain_left_ = 0;
+    bool to_backlog_ = false;
+    // created on the first buffer receive
+    unsigned buf_ring_entries_;
+    unsigned buf_size_;
+    io_uring_buf_ring* buf_ring_ = nullptr;
+    char* buf_base_ = nullptr;
+    // the socket of every buffer receive until its last completion
+    std::unordered_map<IoContext*, SocketHandle> buffer_receives_;
+    // ended by the kernel with ENOBUFS, armed again when a buffer is released
+    std::vector<IoContext*> starved_;
 };
 
 }
@@ -5,6 +5,8 @@
 #include "magio-v3/core/io_context.h"
 #include "magio-v3/net/socket.h"
 
+#include <vector>
+
 #include <MSWSock.h>
 
 namespace magio {
@@ -137,6 +139,7 @@ void IoCompletionPort::write_file(IoHandle ioh, size_t offset, IoContext *ioc) {
     );
     
     if (!status && ERROR_IO_PENDING != ::GetLastError()) {
+        --data_->io_num;
         ioc->cb(SYSTEM_ERROR_CODE, ioc, ioc->ptr);
     }
 }
@@ -155,10 +158,20 @@ void IoCompletionPort::read_file(IoHandle ioh, size_t offset, IoContext *ioc) {
     );
     
     if (!status && ERROR_IO_PENDING != ::GetLastError()) {
+        --data_->io_num;
         ioc->cb(SYSTEM_ERROR_CODE, ioc, ioc->ptr);
     }
 }
 
+// ReadFileScatter/WriteFileGather only take page sized buffers
+void IoCompletionPort::writev_file(IoHandle ioh, size_t offset, IoContext *ioc) {
+    ioc->cb(make_system_error_code(ERROR_NOT_SUPPORTED), ioc, ioc->ptr);
+}
+
+void IoCompletionPort::readv_file(IoHandle ioh, size_t offset, IoContext *ioc) {
+    ioc->cb(make_system_error_code(ERROR_NOT_SUPPORTED), ioc, ioc->ptr);
+}
+
 void IoCompletionPort::accept(const net::Socket& listener, IoContext *ioc) {
     ++data_->io_num;
     ZeroMemory(&ioc->overlapped, sizeof(OVERLAPPED));
@@ -166,6 +179,7 @@ void IoCompletionPort::accept(const net::Socket& listener, IoContext *ioc) {
     std::error_code ec;
     SOCKET sock_handle = detail::open_socket(listener.ip(), listener.transport(), ec);
     if (ec) {
+        --data_->io_num;
         ioc->cb(ec, ioc, ioc->ptr);
         return;
     }
@@ -189,6 +203,7 @@ void IoCompletionPort::accept(const net::Socket& listener, IoContext *ioc) {
     if (!status && ERROR_IO_PENDING != ::GetLastError()) {
         detail::close_socket(sock_handle);
         delete[] ioc->iovec.buf;
+        --data_->io_num;
         ioc->cb(SYSTEM_ERROR_CODE, ioc, ioc->ptr);
     }
 }
@@ -209,6 +224,7 @@ void IoCompletionPort::connect(SocketHandle socket, IoContext *ioc) {
     );
 
     if (!status && ERROR_IO_PENDING != ::GetLastError()) {
+        --data_->io_num;
         ioc->cb(SYSTEM_ERROR_CODE, ioc, ioc->ptr);
     }
 }
@@ -229,6 +245,7 @@ void IoCompletionPort::send(SocketHandle socket, IoContext *ioc) {
     );
 
     if (SOCKET_ERROR == status && ERROR_IO_PENDING != ::GetLastError()) {
+        --data_->io_num;
         ioc->cb(SYSTEM_ERROR_CODE, ioc, ioc->ptr);
     }
 }
@@ -249,6 +266,66 @@ void IoCompletionPort::receive(SocketHandle socket, IoContext *ioc) {
     );
 
     if (SOCKET_ERROR == status && ERROR_IO_PENDING != ::GetLastError()) {
+        --data_->io_num;
+        ioc->cb(SYSTEM_ERROR_CODE, ioc, ioc->ptr);
+    }
+}
+
+// WSASend completes once, the buffer is free again at that point
+void IoCompletionPort::send_zc(SocketHandle socket, IoContext *ioc) {
+    send(socket, ioc);
+}
+
+static std::vector<WSABUF> to_wsa_bufs(IoContext* ioc) {
+    auto bufs = (IoVec*)ioc->iovec.buf;
+    std::vector<WSABUF> wsa_bufs(ioc->iovec.len);
+    for (size_t i = 0; i < wsa_bufs.size(); ++i) {
+        wsa_bufs[i] = io_buf(bufs[i].buf, bufs[i].len);
+    }
+    return wsa_bufs;
+}
+
+// the WSABUF array is captured by the call, only the buffers must outlive it
+void IoCompletionPort::sendv(SocketHandle socket, IoContext *ioc) {
+    ++data_->io_num;
+    ZeroMemory(&ioc->overlapped, sizeof(OVERLAPPED));
+
+    auto wsa_bufs = to_wsa_bufs(ioc);
+    DWORD flag = 0;
+    int status = ::WSASend(
+        socket, 
+        wsa_bufs.data(), 
+        (DWORD)wsa_bufs.size(), 
+        NULL, 
+        flag,
+        (LPOVERLAPPED)&ioc->overlapped, 
+        NULL
+    );
+
+    if (SOCKET_ERROR == status && ERROR_IO_PENDING != ::GetLastError()) {
+        --data_->io_num;
+        ioc->cb(SYSTEM_ERROR_CODE, ioc, ioc->ptr);
+    }
+}
+
+void IoCompletionPort::receivev(SocketHandle socket, IoContext *ioc) {
+    ++data_->io_num;
+    ZeroMemory(&ioc->overlapped, sizeof(OVERLAPPED));
+
+    auto wsa_bufs = to_wsa_bufs(ioc);
+    DWORD flag = 0;
+    int status = ::WSARecv(
+        socket, 
+        wsa_bufs.data(), 
+        (DWORD)wsa_bufs.size(), 
+        NULL,
+        &flag,
+        (LPOVERLAPPED)&ioc->overlapped, 
+        NULL
+    );
+
+    if (SOCKET_ERROR == status && ERROR_IO_PENDING != ::GetLastError()) {
+        --data_->io_num;
         ioc->cb(SYSTEM_ERROR_CODE, ioc, ioc->ptr);
     }
 }
@@ -271,6 +348,7 @@ void IoCompletionPort::send_to(SocketHandle socket, IoContext *ioc) {
     );
 
     if (SOCKET_ERROR == status && ERROR_IO_PENDING != ::GetLastError()) {
+        --data_->io_num;
         ioc->cb(SYSTEM_ERROR_CODE, ioc, ioc->ptr);
     }
 }
@@ -293,18 +371,46 @@ void IoCompletionPort::receive_from(SocketHandle socket, IoContext *ioc) {
     );
 
     if (SOCKET_ERROR == status && ERROR_IO_PENDING != ::GetLastError()) {
+        --data_->io_num;
         ioc->cb(SYSTEM_ERROR_CODE, ioc, ioc->ptr);
     }
 }
 
+void IoCompletionPort::accept_multishot(const net::Socket& listener, IoContext *ioc) {
+    ioc->more = false;
+    ioc->cb(make_system_error_code(ERROR_NOT_SUPPORTED), ioc, ioc->ptr);
+}
+
+// iocp has no provided buffer ring
+void IoCompletionPort::receive_buffer(SocketHandle socket, IoContext *ioc) {
+    ioc->more = false;
+    ioc->cb(make_system_error_code(ERROR_NOT_SUPPORTED), ioc, ioc->ptr);
+}
+
+void IoCompletionPort::release_buffer(uint32_t buf_id) {
+    return;
+}
+
 void IoCompletionPort::cancel(IoHandle ioh) {
     ::CancelIoEx((HANDLE)ioh.ptr, NULL);
 }
 
-int IoCompletionPort::poll(size_t nanosec, std::error_code &ec) {
-    if (nanosec == 0 && data_->io_num == 0) {
-        return 0;
+void IoCompletionPort::cancel(IoContext *ioc) {
+    return;
+}
+
+// the context arrives as a completion of the target port
+void IoCompletionPort::send_message(IoServiceInterface* target, IoContext* ioc) {
+    auto port = static_cast<IoCompletionPort*>(target);
+    std::memset(&ioc->overlapped, 0, sizeof(ioc->overlapped));
+    if (!::PostQueuedCompletionStatus(port->data_->handle, 0, 0, &ioc->overlapped)) {
+        ioc->cb(SYSTEM_ERROR_CODE, ioc, ioc->ptr);
     }
+}
+
+int IoCompletionPort::poll(size_t nanosec, std::error_code &ec) {
+    // without own ops a non blocking poll still looks for messages
+    // posted by other ports, GetQueuedCompletionStatus does not block then
 
     size_t wait_time = nanosec / 1000000;
     for (int i = 0; i < 1024; ++i) {
@@ -337,7 +443,9 @@ int IoCompletionPort::poll(size_t nanosec, std::error_code &ec) {
             return -1;
         }       
 
-        --data_->io_num;
+        if (ioc->op != Operation::Message) {
+            --data_->io_num;
+        }
         switch(ioc->op) {
         case Operation::WriteFile:
         case Operation::ReadFile:
@@ -385,6 +493,9 @@ int IoCompletionPort::poll(size_t nanosec, std::error_code &ec) {
         }
             break;
         case Operation::Send: 
+        case Operation::SendZeroCopy:
+        case Operation::SendVectored:
+        case Operation::ReceiveVectored:
         case Operation::Receive:
         case Operation::SendTo:
         case Operation::ReceiveFrom:
@@ -395,6 +506,7 @@ int IoCompletionPort::poll(size_t nanosec, std::error_code &ec) {
         }
 
         ioc->cb(inner_ec, ioc, ioc->ptr);
+        run_completion_hook();
     }
 
     return 1;
@@ -413,6 +525,11 @@ void IoCompletionPort::attach(IoHandle ioh, std::error_code &ec) {
     }
 }
 
+// a handle stays associated with the port until it is closed
+void IoCompletionPort::detach(IoHandle ioh) {
+    return;
+}
+
 void IoCompletionPort::wake_up() {
     ::PostQueuedCompletionStatus(
         data_->handle, 
@@ -422,6 +539,10 @@ void IoCompletionPort::wake_up() {
     );
 }
 
+size_t IoCompletionPort::inflight() const {
+    return data_->io_num;
+}
+
 }
 
 }
@@ -18,7 +18,13 @@ public:
     
     void read_file(IoHandle ioh, size_t offset, IoContext* ioc) override;
     
+    void writev_file(IoHandle ioh, size_t offset, IoContext* ioc) override;
+
+    void readv_file(IoHandle ioh, size_t offset, IoContext* ioc) override;
+
     void accept(const net::Socket& listener, IoContext* ioc) override;
+
+    void accept_multishot(const net::Socket& listener, IoContext* ioc) override;
     
     void connect(SocketHandle socket, IoContext* ioc) override;
 
@@ -26,18 +32,36 @@ public:
 
     void receive(SocketHandle socket, IoContext* ioc) override;
 
+    void send_zc(SocketHandle socket, IoContext* ioc) override;
+
+    void sendv(SocketHandle socket, IoContext* ioc) override;
+
+    void receivev(SocketHandle socket, IoContext* ioc) override;
+
     void send_to(SocketHandle socket, IoContext* ioc) override;
 
     void receive_from(SocketHandle socket, IoContext* ioc) override;
 
+    void receive_buffer(SocketHandle socket, IoContext* ioc) override;
+
+    void release_buffer(uint32_t buf_id) override;
+
     void cancel(IoHandle ioh) override;
+
+    void cancel(IoContext* ioc) override;
     
     void attach(IoHandle ioh, std::error_code& ec) override;
 
+    void detach(IoHandle ioh) override;
+
+    void send_message(IoServiceInterface* target, IoContext* ioc) override;
+
     int poll(size_t nanosec, std::error_code& ec) override;
 
     void wake_up() override;
 
+    size_t inflight() const override;
+
 private:
     struct Data;
     Data* data_;
@@ -9,6 +9,11 @@
 
 #elif defined(__linux__)
 #include <unistd.h>
+#include <netinet/udp.h>
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
 #endif
 
 namespace magio {
@@ -62,6 +67,20 @@ void close_socket(Socket::Handle handle) {
 #endif
 }
 
+ProvidedBuffer take_buffer(IoContext* ioc) {
+    if (!ioc->iovec.buf) {
+        return {};
+    }
+    return {this_context::get_service(), ioc->iovec.buf, ioc->iovec.len, ioc->buf_id};
+}
+
+#ifdef MAGIO_USE_CORO
+void on_buffer_received(std::error_code ec, IoContext* ioc, void* ptr) {
+    auto receiver = (magio::detail::MultishotReceiver<ProvidedBuffer>*)ptr;
+    receiver->complete(ec, ioc, take_buffer(ioc));
+}
+#endif
+
 }
 
 Socket::Socket() { 
@@ -71,6 +90,7 @@ Socket::Socket() {
 Socket::Socket(Handle handle, Ip ip, Transport tp) {
     handle_ = handle;
     attached_ = nullptr;
+    receiver_ = nullptr;
     ip_ = ip;
     transport_ = tp;
 }
@@ -82,6 +102,7 @@ Socket::~Socket() {
 Socket::Socket(Socket&& other) noexcept
     : handle_(other.handle_)
     , attached_(other.attached_)
+    , receiver_(other.receiver_)
     , ip_(other.ip_)
     , transport_(other.transport_)
 {
@@ -95,6 +116,7 @@ Socket& Socket::operator=(Socket&& other) noexcept {
     
     handle_ = other.handle_;
     attached_ = other.attached_;
+    receiver_ = other.receiver_;
     ip_ = other.ip_;
     transport_ = other.transport_;
     other.reset();
@@ -123,59 +145,187 @@ Result<> Socket::bind(const InetAddress& address) {
     return {};
 }
 
+Segments Socket::to_segments(IoContext* ioc) {
+    return {
+        .len = ioc->res,
+        .segment_size = ioc->segment_size ? ioc->segment_size : ioc->res,
+        .address = InetAddress::from((sockaddr*)&ioc->remote_addr)
+    };
+}
+
+Result<> Socket::set_gro(bool on) {
+#ifdef __linux__
+    int val = on;
+    if (-1 == ::setsockopt(handle_, IPPROTO_UDP, UDP_GRO, &val, sizeof(val))) {
+        return {SYSTEM_ERROR_CODE};
+    }
+    return {};
+#else
+    return {std::make_error_code(std::errc::not_supported)};
+#endif
+}
+
+Result<> Socket::set_reuse_port(bool on) {
+#ifdef __linux__
+    int val = on;
+    if (-1 == ::setsockopt(handle_, SOL_SOCKET, SO_REUSEPORT, &val, sizeof(val))) {
+        return {SYSTEM_ERROR_CODE};
+    }
+    return {};
+#else
+    return {std::make_error_code(std::errc::not_supported)};
+#endif
+}
+
 #ifdef MAGIO_USE_CORO
-Coro<Result<>> Socket::connect(const InetAddress& address) {
+Coro<Result<>> Socket::connect(const InetAddress& address, Deadline deadline) {
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().connect(ioc, handle_, address, ptr, cb, deadline);
+    });
+    auto ec = co_await awaiter;
+
+    co_return ec;
+}
+
+Coro<Result<size_t>> Socket::receive(char* buf, size_t len, Deadline deadline) {
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().receive(ioc, handle_, buf, len, ptr, cb, deadline);
+    });
+    auto ec = co_await awaiter;
+
+    co_return {awaiter.context().res, ec};
+}
+
+Coro<Result<size_t>> Socket::send(const char* msg, size_t len, Deadline deadline) {
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().send(ioc, handle_, msg, len, ptr, cb, deadline);
+    });
+    auto ec = co_await awaiter;
+
+    co_return {awaiter.context().res, ec};
+}
+
+Coro<Result<size_t>> Socket::send(std::span<const IoVec> bufs) {
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().sendv(ioc, handle_, bufs.data(), bufs.size(), ptr, cb);
+    });
+    auto ec = co_await awaiter;
+
+    co_return {awaiter.context().res, ec};
+}
+
+Coro<Result<size_t>> Socket::receive(std::span<const IoVec> bufs) {
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().receivev(ioc, handle_, bufs.data(), bufs.size(), ptr, cb);
+    });
+    auto ec = co_await awaiter;
+
+    co_return {awaiter.context().res, ec};
+}
+
+Coro<Result<size_t>> Socket::send_zc(const char* msg, size_t len) {
+    attach_context();
+    IoAwaiter awaiter([&](IoContext& ioc, void* ptr, IoService::Cb cb) {
+        this_context::get_service().send_zc(ioc, handle_, msg, len, ptr, cb);
+    });
+    auto ec = co_await awaiter;
+
+    co_return {awaiter.context().res, ec};
+}
+
+Coro<Result<size_t>> Socket::send_to(const char* msg, size_t len, const InetAddress& address) {
     attach_context();
-    std::error_code ec;
     ResumeHandle rh;
+
     co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
         rh.handle = h;
-        this_context::get_service().connect(handle_, address, &rh, resume_callback);
+        this_context::get_service().send_to(handle_, address, msg, len, &rh, resume_callback);
     });
 
-    co_return rh.ec;
+    co_return {rh.res, rh.ec};
 }
 
-Coro<Result<size_t>> Socket::receive(char* buf, size_t len) {
+Coro<Result<std::pair<size_t, InetAddress>>> Socket::receive_from(char* buf, size_t len) {
     attach_context();
-    std::error_code ec;
-    ResumeHandle rh;
+    struct RecvResume: ResumeHandle {
+        InetAddress address;
+    } rh;
+
     co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
         rh.handle = h;
-        this_context::get_service().receive(handle_, buf, len, &rh, resume_callback);
+        this_context::get_service().receive_from(handle_, buf, len, &rh, 
+            [](std::error_code ec, IoContext* ioc, void* ptr) {
+                auto rh = (RecvResume*)ptr;
+                rh->ec = ec;
+                rh->res = ioc->res;
+                rh->address = InetAddress::from((sockaddr*)&ioc->remote_addr);
+                rh->handle.resume();
+
+                delete ioc;
+            });
     });
 
-    co_return {rh.res, rh.ec};
+    if (rh.ec) {
+        co_return {rh.ec};
+    }
+    co_return {{rh.res, rh.address}};
 }
 
-Coro<Result<size_t>> Socket::send(const char* msg, size_t len) {
+Coro<Result<size_t>> Socket::send_to(std::span<const Datagram> datagrams) {
     attach_context();
-    ResumeHandle rh;
+    struct BatchResume: ResumeHandle {
+        size_t left;
+    } rh;
+    rh.res = 0;
+    // one extra count, so a batch completed inline resumes after the loop
+    rh.left = datagrams.size() + 1;
 
     co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
         rh.handle = h;
-        this_context::get_service().send(handle_, msg, len, &rh, resume_callback);
+        for (auto& datagram : datagrams) {
+            this_context::get_service().send_to(handle_, datagram.address, datagram.data, datagram.len, &rh, 
+                [](std::error_code ec, IoContext* ioc, void* ptr) {
+                    auto rh = (BatchResume*)ptr;
+                    if (ec) {
+                        rh->ec = rh->ec ? rh->ec : ec;
+                    } else {
+                        ++rh->res;
+                    }
+                    delete ioc;
+                    if (--rh->left == 0) {
+                        rh->handle.resume();
+                    }
+                });
+        }
+        if (--rh.left == 0) {
+            h.resume();
+        }
     });
 
     co_return {rh.res, rh.ec};
 }
 
-Coro<Result<size_t>> Socket::send_to(const char* msg, size_t len, const InetAddress& address) {
+Coro<Result<size_t>> Socket::send_segments_to(const char* msg, size_t len, size_t segment_size, const InetAddress& address) {
     attach_context();
     ResumeHandle rh;
 
     co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
         rh.handle = h;
-        this_context::get_service().send_to(handle_, address, msg, len, &rh, resume_callback);
+        this_context::get_service().send_to(handle_, address, msg, len, &rh, resume_callback, segment_size);
     });
 
     co_return {rh.res, rh.ec};
 }
 
-Coro<Result<std::pair<size_t, InetAddress>>> Socket::receive_from(char* buf, size_t len) {
+Coro<Result<Segments>> Socket::receive_segments_from(char* buf, size_t len) {
     attach_context();
     struct RecvResume: ResumeHandle {
-        InetAddress address;
+        Segments segments;
     } rh;
 
     co_await GetCoroutineHandle([&](std::coroutine_handle<> h) {
@@ -184,8 +334,7 @@ Coro<Result<std::pair<size_t, InetAddress>>> Socket::receive_from(char* buf, siz
             [](std::error_code ec, IoContext* ioc, void* ptr) {
                 auto rh = (RecvResume*)ptr;
                 rh->ec = ec;
-                rh->res = ioc->res;
-                rh->address = InetAddress::from((sockaddr*)&ioc->remote_addr);
+                rh->segments = to_segments(ioc);
                 rh->handle.resume();
 
                 delete ioc;
@@ -195,11 +344,46 @@ Coro<Result<std::pair<size_t, InetAddress>>> Socket::receive_from(char* buf, siz
     if (rh.ec) {
         co_return {rh.ec};
     }
-    co_return {{rh.res, rh.address}};
+    co_return {std::move(rh.segments)};
+}
+
+Coro<Result<ProvidedBuffer>> Socket::receive_buffer() {
+    attach_context();
+    if (!receiver_) {
+        receiver_ = new magio::detail::MultishotReceiver<ProvidedBuffer>;
+    }
+
+    auto receiver = receiver_;
+    if (receiver->ready.empty() && !receiver->ioc) {
+        // set before the op is submitted, an inline completion clears it
+        receiver->ioc = new IoContext;
+        this_context::get_service().receive_buffer(
+            *receiver->ioc, handle_, receiver, detail::on_buffer_received
+        );
+    }
+
+    if (receiver->ready.empty()) {
+        co_await GetCoroutineHandle([receiver](std::coroutine_handle<> h) {
+            receiver->waiter = h;
+        });
+    } else if (!magio::detail::consume_coop_budget()) {
+        // ready without suspending, but the budget is spent
+        co_await this_coro::yield;
+    }
+
+    auto [ec, buf] = receiver->pop();
+    if (ec) {
+        co_return {ec};
+    }
+    co_return {std::move(buf)};
 }
 #endif
 
 void Socket::connect(const InetAddress &address, Functor<void (std::error_code)> &&completion_cb) {
+    connect(address, Deadline{}, std::move(completion_cb));
+}
+
+void Socket::connect(const InetAddress &address, Deadline deadline, Functor<void (std::error_code)> &&completion_cb) {
     using Cb = Functor<void (std::error_code)>;
     attach_context();
 
@@ -209,10 +393,14 @@ void Socket::connect(const InetAddress &address, Functor<void (std::error_code)>
             (*cb)(ec);
             delete cb;
             delete ioc;
-        });
+        }, deadline);
 }
 
 void Socket::receive(char *buf, size_t len, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    receive(buf, len, Deadline{}, std::move(completion_cb));
+}
+
+void Socket::receive(char *buf, size_t len, Deadline deadline, Functor<void (std::error_code, size_t)> &&completion_cb) {
     using Cb = Functor<void (std::error_code, size_t)>;
     attach_context();
 
@@ -222,14 +410,57 @@ void Socket::receive(char *buf, size_t len, Functor<void (std::error_code, size_
             (*cb)(ec, ioc->res);
             delete cb;
             delete ioc;
-        });
+        }, deadline);
 }
 
 void Socket::send(const char *msg, size_t len, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    send(msg, len, Deadline{}, std::move(completion_cb));
+}
+
+void Socket::send(const char *msg, size_t len, Deadline deadline, Functor<void (std::error_code, size_t)> &&completion_cb) {
     using Cb = Functor<void (std::error_code, size_t)>;
     attach_context();
 
     this_context::get_service().send(handle_, msg, len, new Cb(std::move(completion_cb)),
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto cb = (Cb*)ptr;
+            (*cb)(ec, ioc->res);
+            delete cb;
+            delete ioc;
+        }, deadline);
+}
+
+void Socket::send(std::span<const IoVec> bufs, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, size_t)>;
+    attach_context();
+
+    this_context::get_service().sendv(handle_, bufs.data(), bufs.size(), new Cb(std::move(completion_cb)),
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto cb = (Cb*)ptr;
+            (*cb)(ec, ioc->res);
+            delete cb;
+            delete ioc;
+        });
+}
+
+void Socket::receive(std::span<const IoVec> bufs, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, size_t)>;
+    attach_context();
+
+    this_context::get_service().receivev(handle_, bufs.data(), bufs.size(), new Cb(std::move(completion_cb)),
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto cb = (Cb*)ptr;
+            (*cb)(ec, ioc->res);
+            delete cb;
+            delete ioc;
+        });
+}
+
+void Socket::send_zc(const char *msg, size_t len, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, size_t)>;
+    attach_context();
+
+    this_context::get_service().send_zc(handle_, msg, len, new Cb(std::move(completion_cb)),
         [](std::error_code ec, IoContext* ioc, void* ptr) {
             auto cb = (Cb*)ptr;
             (*cb)(ec, ioc->res);
@@ -271,6 +502,85 @@ void Socket::receive_from(char *buf, size_t len, Functor<void (std::error_code,
         });
 }
 
+void Socket::send_to(std::span<const Datagram> datagrams, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, size_t)>;
+    attach_context();
+    struct Batch {
+        Cb cb;
+        std::error_code ec;
+        size_t sent;
+        size_t left;
+    };
+    // one extra count, so a batch completed inline is freed after the loop
+    auto batch = new Batch{.cb = std::move(completion_cb), .sent = 0, .left = datagrams.size() + 1};
+
+    for (auto& datagram : datagrams) {
+        this_context::get_service().send_to(handle_, datagram.address, datagram.data, datagram.len, batch, 
+            [](std::error_code ec, IoContext* ioc, void* ptr) {
+                auto batch = (Batch*)ptr;
+                if (ec) {
+                    batch->ec = batch->ec ? batch->ec : ec;
+                } else {
+                    ++batch->sent;
+                }
+                delete ioc;
+                if (--batch->left == 0) {
+                    batch->cb(batch->ec, batch->sent);
+                    delete batch;
+                }
+            });
+    }
+    if (--batch->left == 0) {
+        batch->cb(batch->ec, batch->sent);
+        delete batch;
+    }
+}
+
+void Socket::send_segments_to(const char *msg, size_t len, size_t segment_size, const InetAddress &address, Functor<void (std::error_code, size_t)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, size_t)>;
+    attach_context();
+
+    this_context::get_service().send_to(handle_, address, msg, len, new Cb(std::move(completion_cb)), 
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto cb = (Cb*)ptr;
+            (*cb)(ec, ioc->res);
+            delete cb;
+            delete ioc;
+        }, segment_size);
+}
+
+void Socket::receive_segments_from(char *buf, size_t len, Functor<void (std::error_code, Segments)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, Segments)>;
+    attach_context();
+
+    this_context::get_service().receive_from(handle_, buf, len, new Cb(std::move(completion_cb)),
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto cb = (Cb*)ptr;
+            if (ec) {
+                (*cb)(ec, {});
+            } else {
+                (*cb)(ec, to_segments(ioc));
+            }
+            delete cb;
+            delete ioc;
+        });
+}
+
+void Socket::receive_buffer(Functor<void (std::error_code, ProvidedBuffer)> &&completion_cb) {
+    using Cb = Functor<void (std::error_code, ProvidedBuffer)>;
+    attach_context();
+
+    this_context::get_service().receive_buffer(handle_, new Cb(std::move(completion_cb)),
+        [](std::error_code ec, IoContext* ioc, void* ptr) {
+            auto cb = (Cb*)ptr;
+            (*cb)(ec, detail::take_buffer(ioc));
+            if (!ioc->more) {
+                delete cb;
+                delete ioc;
+            }
+        });
+}
+
 void Socket::cancel() {
     if (kInvalidHandle != handle_) {
         this_context::get_service().cancel(IoHandle{.a = handle_});
@@ -279,7 +589,21 @@ void Socket::cancel() {
 
 void Socket::close() {
     if (kInvalidHandle != handle_) {
-        detail::close_socket(handle_);
+        if (attached_) {
+            // the ring is only touched on the thread of its context, and the handle
+            // is closed after its fixed file slot is cleared, so its number is not reused first
+            attached_->dispatch([service = attached_->get_service(), handle = handle_, receiver = receiver_]() mutable {
+#ifdef MAGIO_USE_CORO
+                if (receiver) {
+                    receiver->drop(service);
+                }
+#endif
+                service.detach(IoHandle{.a = handle});
+                detail::close_socket(handle);
+            });
+        } else {
+            detail::close_socket(handle_);
+        }
         reset();
     }
 }
@@ -307,6 +631,7 @@ void Socket::attach_context() {
 void Socket::reset() {
     handle_ = kInvalidHandle;
     attached_ = nullptr;
+    receiver_ = nullptr;
     ip_ = Ip::v4;
     transport_ = Transport::Tcp;
 }
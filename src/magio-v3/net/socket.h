@@ -1,13 +1,16 @@
 #ifndef MAGIO_NET_SOCKET_H_
 #define MAGIO_NET_SOCKET_H_
 
+#include <span>
 #include <cstring>
 
 #include "magio-v3/utils/functor.h"
 #include "magio-v3/utils/noncopyable.h"
 #include "magio-v3/core/error.h"
 #include "magio-v3/core/common.h"
+#include "magio-v3/core/io_service.h"
 #include "magio-v3/net/protocal.h"
+#include "magio-v3/net/address.h"
 
 namespace magio {
 
@@ -16,9 +19,29 @@ class CoroContext;
 template<typename>
 class Coro;
 
+namespace detail {
+
+template<typename>
+struct MultishotReceiver;
+
+}
+
 namespace net {
 
-class InetAddress;
+// one datagram of a batch send
+struct Datagram {
+    const char* data;
+    size_t len;
+    InetAddress address;
+};
+
+// datagrams of one peer coalesced by udp gro, every segment_size bytes 
+// of the buffer is one datagram, the last one may be shorter
+struct Segments {
+    size_t len = 0;
+    size_t segment_size = 0;
+    InetAddress address;
+};
 
 class Socket: Noncopyable {
     friend class Acceptor;
@@ -44,33 +67,103 @@ public:
     [[nodiscard]]
     Result<> bind(const InetAddress& address);
 
+    // udp generic receive offload. std::errc::not_supported on windows,
+    // the coalesced size there is only reported through WSARecvMsg
+    Result<> set_gro(bool on);
+
+    // several sockets may bind the same address, the kernel spreads 
+    // connections or datagrams over them. must be set before bind
+    Result<> set_reuse_port(bool on);
+
 #ifdef MAGIO_USE_CORO
+    // an expired deadline cancels the op with std::errc::timed_out,
+    // on windows a deadline fails the op with std::errc::not_supported
     [[nodiscard]]
-    Coro<Result<>> connect(const InetAddress& address);
+    Coro<Result<>> connect(const InetAddress& address, Deadline deadline = {});
 
     [[nodiscard]]
-    Coro<Result<size_t>> send(const char* msg, size_t len);
+    Coro<Result<size_t>> send(const char* msg, size_t len, Deadline deadline = {});
 
     [[nodiscard]]
-    Coro<Result<size_t>> receive(char* buf, size_t len);
+    Coro<Result<size_t>> receive(char* buf, size_t len, Deadline deadline = {});
+
+    // gather, the whole span goes out in one sendmsg
+    [[nodiscard]]
+    Coro<Result<size_t>> send(std::span<const IoVec> bufs);
+
+    // scatter, one recvmsg fills the buffers in order
+    [[nodiscard]]
+    Coro<Result<size_t>> receive(std::span<const IoVec> bufs);
+
+    // zero copy, resumes once msg can be reused
+    [[nodiscard]]
+    Coro<Result<size_t>> send_zc(const char* msg, size_t len);
 
     [[nodiscard]]
     Coro<Result<size_t>> send_to(const char* msg, size_t len, const InetAddress& address);
 
     [[nodiscard]]
     Coro<Result<std::pair<size_t, InetAddress>>> receive_from(char* buf, size_t len);
+
+    // one sendmsg per datagram, all prepared before the coroutine suspends,
+    // so they usually leave with one submit. a batch past the submit threshold
+    // (CoroContextOptions::submit_threshold) is split. yields how many were sent
+    [[nodiscard]]
+    Coro<Result<size_t>> send_to(std::span<const Datagram> datagrams);
+
+    // udp gso, the kernel cuts msg into datagrams of segment_size bytes.
+    // std::errc::not_supported on windows, it would need WSASendMsg
+    [[nodiscard]]
+    Coro<Result<size_t>> send_segments_to(const char* msg, size_t len, size_t segment_size, const InetAddress& address);
+
+    // needs set_gro(true), one completion may carry several datagrams,
+    // only those of one flow are coalesced. there is no batched receive 
+    // of datagrams from many peers, each receive_from takes one
+    [[nodiscard]]
+    Coro<Result<Segments>> receive_segments_from(char* buf, size_t len);
+
+    // the first call arms a multishot receive on the context's buffer ring,
+    // every call hands back the next filled buffer, an empty buffer means EOF.
+    // the ring is shared by the sockets of the context, once it runs dry
+    // the receive waits until a ProvidedBuffer is released, it does not fail
+    [[nodiscard]]
+    Coro<Result<ProvidedBuffer>> receive_buffer();
 #endif
 
     void connect(const InetAddress& address, Functor<void(std::error_code)>&& completion_cb);
 
+    void connect(const InetAddress& address, Deadline deadline, Functor<void(std::error_code)>&& completion_cb);
+
     void send(const char* msg, size_t len, Functor<void(std::error_code, size_t)>&& completion_cb);
 
+    void send(const char* msg, size_t len, Deadline deadline, Functor<void(std::error_code, size_t)>&& completion_cb);
+
     void receive(char* buf, size_t len, Functor<void(std::error_code, size_t)>&& completion_cb);
 
+    void receive(char* buf, size_t len, Deadline deadline, Functor<void(std::error_code, size_t)>&& completion_cb);
+
+    // bufs must stay valid until completion_cb is invoked
+    void send(std::span<const IoVec> bufs, Functor<void(std::error_code, size_t)>&& completion_cb);
+
+    void receive(std::span<const IoVec> bufs, Functor<void(std::error_code, size_t)>&& completion_cb);
+
+    // zero copy, completion_cb is invoked once msg can be reused
+    void send_zc(const char* msg, size_t len, Functor<void(std::error_code, size_t)>&& completion_cb);
+
     void send_to(const char* msg, size_t len, const InetAddress& address, Functor<void(std::error_code, size_t)>&& completion_cb);
 
     void receive_from(char* buf, size_t len, Functor<void(std::error_code ec, size_t, InetAddress)>&& completion_cb);
 
+    void send_to(std::span<const Datagram> datagrams, Functor<void(std::error_code, size_t)>&& completion_cb);
+
+    void send_segments_to(const char* msg, size_t len, size_t segment_size, const InetAddress& address, Functor<void(std::error_code, size_t)>&& completion_cb);
+
+    void receive_segments_from(char* buf, size_t len, Functor<void(std::error_code, Segments)>&& completion_cb);
+
+    // completion_cb is invoked once per message until an error or EOF,
+    // a dry buffer ring only delays it, see the coroutine version
+    void receive_buffer(Functor<void(std::error_code, ProvidedBuffer)>&& completion_cb);
+
     void cancel();
 
     void shutdown(Shutdown type);
@@ -100,9 +193,12 @@ private:
 
     void reset();
 
+    static Segments to_segments(IoContext* ioc);
+
     Handle handle_ = kInvalidHandle;
 
     CoroContext* attached_;
+    magio::detail::MultishotReceiver<ProvidedBuffer>* receiver_;
     Ip ip_ = Ip::v4;
     Transport transport_ = Transport::Tcp;
 };
@@ -0,0 +1,165 @@
+#ifndef MAGIO_UTILS_FRAME_POOL_H_
+#define MAGIO_UTILS_FRAME_POOL_H_
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace magio {
+
+// Allocates coroutine frames from per thread caches of size classes.
+// A block freed on another thread is pushed onto its owner's remote list,
+// the owner takes the list back when one of its classes runs dry.
+// A cache outlives its thread, it is handed to the next thread that 
+// needs one, so late remote frees always have somewhere to go.
+class FramePool {
+    static constexpr size_t kGranularity = 64;
+    // frames up to 2 KiB are pooled
+    static constexpr uint32_t kClasses = 32;
+    // cached blocks per class
+    static constexpr size_t kCapacity = 256;
+    static constexpr uint32_t kUnpooled = kClasses;
+
+    struct Cache;
+
+    struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) Header {
+        union {
+            // in use
+            Cache* owner;
+            // cached, local or remote list
+            Header* next;
+        };
+        uint32_t cls;
+    };
+
+    struct Cache {
+        Header* heads[kClasses] = {};
+        size_t sizes[kClasses] = {};
+        std::atomic<Header*> remote{nullptr};
+    };
+
+    // gives the cache up when the thread exits
+    struct Cleaner {
+        ~Cleaner() {
+            closed_ = true;
+            for (uint32_t cls = 0; cls < kClasses; ++cls) {
+                auto& head = cache_->heads[cls];
+                while (head) {
+                    ::operator delete(std::exchange(head, head->next));
+                }
+                cache_->sizes[cls] = 0;
+            }
+
+            std::lock_guard lk(orphans_mutex());
+            orphans().push_back(cache_);
+        }
+    };
+
+public:
+    static void* allocate(size_t size) {
+        uint32_t cls = (size + sizeof(Header) - 1) / kGranularity;
+        Cache* cache = local();
+        if (cls >= kClasses || !cache) {
+            auto h = ::new (::operator new(size + sizeof(Header))) Header;
+            h->cls = kUnpooled;
+            return h + 1;
+        }
+
+        if (!cache->heads[cls]) {
+            take_remote(cache);
+        }
+
+        Header* h;
+        if (auto& head = cache->heads[cls]; head) {
+            h = std::exchange(head, head->next);
+            --cache->sizes[cls];
+        } else {
+            h = ::new (::operator new((cls + 1) * kGranularity)) Header;
+        }
+
+        h->owner = cache;
+        h->cls = cls;
+        return h + 1;
+    }
+
+    static void deallocate(void* p) {
+        auto h = (Header*)p - 1;
+        if (h->cls == kUnpooled) {
+            ::operator delete(h);
+            return;
+        }
+
+        Cache* owner = h->owner;
+        if (owner == cache_ && !closed_) {
+            cache_block(owner, h);
+            return;
+        }
+
+        h->next = owner->remote.load(std::memory_order_relaxed);
+        while (!owner->remote.compare_exchange_weak(h->next, h, 
+            std::memory_order_release, std::memory_order_relaxed)) 
+        { }
+    }
+
+private:
+    // nullptr once the thread is exiting
+    static Cache* local() {
+        if (cache_ || closed_) {
+            return closed_ ? nullptr : cache_;
+        }
+
+        {
+            std::lock_guard lk(orphans_mutex());
+            if (!orphans().empty()) {
+                cache_ = orphans().back();
+                orphans().pop_back();
+            }
+        }
+        if (!cache_) {
+            cache_ = new Cache;
+        }
+
+        static thread_local Cleaner cleaner;
+        return cache_;
+    }
+
+    static void take_remote(Cache* cache) {
+        Header* h = cache->remote.exchange(nullptr, std::memory_order_acquire);
+        while (h) {
+            cache_block(cache, std::exchange(h, h->next));
+        }
+    }
+
+    static void cache_block(Cache* cache, Header* h) {
+        if (cache->sizes[h->cls] == kCapacity) {
+            ::operator delete(h);
+            return;
+        }
+
+        h->next = std::exchange(cache->heads[h->cls], h);
+        ++cache->sizes[h->cls];
+    }
+
+    // never destroyed, threads may exit after static destruction
+    static std::mutex& orphans_mutex() {
+        static auto m = new std::mutex;
+        return *m;
+    }
+
+    static std::vector<Cache*>& orphans() {
+        static auto v = new std::vector<Cache*>;
+        return *v;
+    }
+
+    // trivial, so they are still usable after the cleaner has run
+    static inline thread_local Cache* cache_ = nullptr;
+    static inline thread_local bool closed_ = false;
+};
+
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef MAGIO_UTILS_FREE_LIST_H_
+#define MAGIO_UTILS_FREE_LIST_H_
+
+#include <new>
+#include <cstddef>
+#include <utility>
+
+namespace magio {
+
+// A per thread cache of freed blocks of sizeof(T),
+// so the steady state allocations of T do not touch the heap.
+// A block may be freed on another thread, it then joins that thread's cache.
+template<typename T, size_t Capacity = 1024>
+class FreeList {
+    struct Node {
+        Node* next;
+    };
+
+    static_assert(sizeof(T) >= sizeof(Node));
+
+    // drains the cache when the thread exits
+    struct Cleaner {
+        ~Cleaner() {
+            closed_ = true;
+            while (head_) {
+                ::operator delete(std::exchange(head_, head_->next));
+            }
+            size_ = 0;
+        }
+    };
+
+public:
+    static void* allocate() {
+        if (head_) {
+            --size_;
+            return std::exchange(head_, head_->next);
+        }
+
+        return ::operator new(sizeof(T));
+    }
+
+    static void deallocate(void* p) {
+        if (closed_ || size_ == Capacity) {
+            ::operator delete(p);
+            return;
+        }
+
+        // registered before the first block is cached
+        static thread_local Cleaner cleaner;
+        head_ = ::new (p) Node{head_};
+        ++size_;
+    }
+
+private:
+    // trivial, so they are still usable after the cleaner has run
+    static inline thread_local Node* head_ = nullptr;
+    static inline thread_local size_t size_ = 0;
+    static inline thread_local bool closed_ = false;
+};
+
+}
+
+#endif
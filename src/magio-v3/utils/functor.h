@@ -1,150 +1,176 @@
 #ifndef MAGIO_UTILS_FUNCTOR_H_
 #define MAGIO_UTILS_FUNCTOR_H_
 
-#include <cstdio>
+#include <new>
+#include <cstring>
+#include <utility>
 
 #include "magio-v3/utils/traits.h"
 #include "magio-v3/utils/noncopyable.h"
+#include "magio-v3/utils/free_list.h"
 
 namespace magio {
 
 template<typename F>
 class Functor;
 
+// A move only std::function. Callables of up to kInlineSize bytes are 
+// stored inline, trivially copyable ones are moved by copying the bytes.
 template<typename Ret, typename...Args>
 class Functor<Ret(Args...)>: Noncopyable {
     // int->int&&, int&->int&, int&&->int&&
     template<typename T>
     using BeRef = std::conditional_t<std::is_reference_v<T>, T, T&&>;
 
-    class FunctorBase {
-    public:
-        virtual ~FunctorBase() = default;
-        virtual Ret operator()(BeRef<Args>...args) = 0;
+    static constexpr size_t kInlineSize = 4 * sizeof(void*);
+
+    union Storage {
+        Ret(*cfunc)(Args...);
+        void* ptr;
+        alignas(void*) unsigned char buf[kInlineSize];
     };
 
-    template<typename...>
-    class FunctorImpl;
+    using Invoke = Ret(*)(Storage&, BeRef<Args>...);
+    // dst != nullptr: moves src into dst and destroys src, else destroys src
+    using Manage = void(*)(Storage& src, Storage* dst);
 
     template<typename Class>
-    class FunctorImpl<Class>: public FunctorBase {
-    public:
-        FunctorImpl(const Class& other)
-            : obj_(other) 
-        { }
-
-        FunctorImpl(Class&& other)
-            : obj_(std::move(other))
-        { }
-
-        Ret operator()(BeRef<Args>...args) override {
-            return obj_(std::forward<Args>(args)...);
-        }
+    static constexpr bool kFitsInline = 
+        sizeof(Class) <= kInlineSize && 
+        alignof(void*) % alignof(Class) == 0 &&
+        std::is_nothrow_move_constructible_v<Class>;
 
-    private:
-        Class obj_;
-    };
-    
-public:
-    using Self = Functor<Ret(Args...)>;
+    static Ret invoke_cfunc(Storage& s, BeRef<Args>...args) {
+        return s.cfunc(std::forward<Args>(args)...);
+    }
 
-    enum Strategy {
-        CFunction,
-        ClassFunction
-    };
+    template<typename Class>
+    static Ret invoke_inline(Storage& s, BeRef<Args>...args) {
+        return (*std::launder((Class*)s.buf))(std::forward<Args>(args)...);
+    }
 
-    Functor() { 
-        impl_.ptr = nullptr;
+    template<typename Class>
+    static Ret invoke_heap(Storage& s, BeRef<Args>...args) {
+        return (*(Class*)s.ptr)(std::forward<Args>(args)...);
     }
 
-    ~Functor() {
-        if (impl_.ptr && strategy_ == ClassFunction) {
-            delete impl_.functorbase;
+    template<typename Class>
+    static void manage_inline(Storage& src, Storage* dst) {
+        auto obj = std::launder((Class*)src.buf);
+        if (dst) {
+            ::new (dst->buf) Class(std::move(*obj));
         }
+        obj->~Class();
     }
 
-    Functor(Ret(*cfunc)(Args...)) {
-        strategy_ = CFunction;
-        impl_.cfunc = cfunc;
+    template<typename Class>
+    static void manage_heap(Storage& src, Storage* dst) {
+        if (dst) {
+            dst->ptr = src.ptr;
+        } else {
+            delete (Class*)src.ptr;
+        }
     }
 
-    template<
-        typename Class, 
-        constraint<
-            std::is_class_v<Class> &&
-            !std::is_same_v<Class, Self> &&
-            std::is_invocable_v<Class, Args...>
-        > = 0
-    >
-    Functor(const Class& lobj) {
-        strategy_ = ClassFunction;
-        impl_.functorbase = new FunctorImpl<Class>(lobj);
+public:
+    using Self = Functor<Ret(Args...)>;
+
+    Functor() = default;
+
+    ~Functor() {
+        reset();
+    }
+
+    Functor(Ret(*cfunc)(Args...)) {
+        if (cfunc) {
+            storage_.cfunc = cfunc;
+            invoke_ = &invoke_cfunc;
+        }
     }
 
     template<
-        typename Class, 
+        typename Callable, 
+        typename Class = std::decay_t<Callable>,
         constraint<
             std::is_class_v<Class> &&
             !std::is_same_v<Class, Self> &&
             std::is_invocable_v<Class, Args...>
         > = 0
     >
-    Functor(Class&& robj) {
-        strategy_ = ClassFunction;
-        impl_.functorbase = new FunctorImpl<Class>(std::move(robj));
+    Functor(Callable&& obj) {
+        if constexpr (kFitsInline<Class>) {
+            ::new (storage_.buf) Class(std::forward<Callable>(obj));
+            invoke_ = &invoke_inline<Class>;
+            if constexpr (!std::is_trivially_copyable_v<Class>) {
+                manage_ = &manage_inline<Class>;
+            }
+        } else {
+            storage_.ptr = new Class(std::forward<Callable>(obj));
+            invoke_ = &invoke_heap<Class>;
+            manage_ = &manage_heap<Class>;
+        }
     }
 
-    Functor(Functor&& other) noexcept // init
-        : strategy_(other.strategy_)
-        , impl_(other.impl_) 
-    {
-        if (impl_.ptr) {
-            other.impl_.ptr = nullptr;
-        }
+    Functor(Functor&& other) noexcept {
+        take(other);
     }
 
     Functor& operator=(Functor&& other) noexcept {
-        if (impl_.ptr == other.impl_.ptr) { // self
-            return *this;
-        }
-
-        strategy_ = other.strategy_;
-        impl_ = other.impl_;
-        if (impl_.ptr) {
-            other.impl_.ptr = nullptr;
+        if (this != &other) {
+            reset();
+            take(other);
         }
         return *this;
     }
 
     void swap(Functor& other) {
-        std::swap(strategy_, other.strategy_);
-        std::swap(impl_, other.impl_);
+        Functor tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
     }
 
     Ret operator()(Args...args) {
-        switch(strategy_) {
-        case CFunction:
-            impl_.cfunc(std::forward<Args>(args)...);
-            break;
-        case ClassFunction:
-            (*impl_.functorbase)(std::forward<Args>(args)...);
-            break;
-        }
+        return invoke_(storage_, std::forward<Args>(args)...);
     }
 
-    operator bool() {
-        return impl_.ptr;
+    operator bool() const {
+        return invoke_;
+    }
+
+    // for the callback flavours of io, which keep the functor on the heap
+    static void* operator new(size_t) {
+        return FreeList<Functor>::allocate();
+    }
+
+    static void operator delete(void* p) {
+        FreeList<Functor>::deallocate(p);
     }
 
 private:
-    Strategy strategy_;
-    union {
-        Ret(*cfunc)(Args...);
-        FunctorBase* functorbase;
-        void* ptr;
-    } impl_;
+    void take(Functor& other) {
+        if (other.manage_) {
+            other.manage_(other.storage_, &storage_);
+        } else {
+            std::memcpy(&storage_, &other.storage_, sizeof(Storage));
+        }
+        invoke_ = std::exchange(other.invoke_, nullptr);
+        manage_ = std::exchange(other.manage_, nullptr);
+    }
+
+    void reset() {
+        if (manage_) {
+            manage_(storage_, nullptr);
+        }
+        invoke_ = nullptr;
+        manage_ = nullptr;
+    }
+
+    Invoke invoke_ = nullptr;
+    // nullptr, storage_ is moved by copying the bytes and needs no destruction
+    Manage manage_ = nullptr;
+    Storage storage_;
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
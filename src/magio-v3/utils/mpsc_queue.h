@@ -0,0 +1,71 @@
+#ifndef MAGIO_UTILS_MPSC_QUEUE_H_
+#define MAGIO_UTILS_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <vector>
+
+#include "magio-v3/utils/noncopyable.h"
+#include "magio-v3/utils/free_list.h"
+
+namespace magio {
+
+// A lock free queue of many producers and one consumer.
+// Producers push onto an intrusive stack, the consumer takes the whole
+// stack with one exchange and reverses it, so values come out in push order.
+template<typename T>
+class MpscQueue: Noncopyable {
+    struct Node {
+        Node* next;
+        T value;
+
+        static void* operator new(size_t) {
+            return FreeList<Node>::allocate();
+        }
+
+        static void operator delete(void* p) {
+            FreeList<Node>::deallocate(p);
+        }
+    };
+
+public:
+    MpscQueue() = default;
+
+    ~MpscQueue() {
+        std::vector<T> rest;
+        pop_all(rest);
+    }
+
+    void push(T&& value) {
+        auto node = new Node{head_.load(std::memory_order_relaxed), std::move(value)};
+        // seq_cst, it pairs with a sleep flag checked by the consumer after empty()
+        while (!head_.compare_exchange_weak(node->next, node)) { }
+    }
+
+    // consumer only, appends every pushed value to out
+    void pop_all(std::vector<T>& out) {
+        Node* head = head_.exchange(nullptr, std::memory_order_acquire);
+        Node* reversed = nullptr;
+        while (head) {
+            auto next = head->next;
+            head->next = reversed;
+            reversed = head;
+            head = next;
+        }
+
+        while (reversed) {
+            out.push_back(std::move(reversed->value));
+            delete std::exchange(reversed, reversed->next);
+        }
+    }
+
+    bool empty() const {
+        return head_.load() == nullptr;
+    }
+
+private:
+    std::atomic<Node*> head_{nullptr};
+};
+
+}
+
+#endif